@@ -0,0 +1,252 @@
+/**
+ * bridge_bench.cpp
+ * 
+ * Round trips through a real [node] and IPC bridge, with a stand-in Pd
+ * and a C++ echo child in place of the JavaScript runtime
+ * 
+ * Usage: pd_node_bench [--count n] [--window n] [--list n] [-- node flags]
+ * 
+ * Keeps `window` messages in flight and reports, per message type,
+ * throughput, round trip latency (inlet call to outlet call) and the CPU
+ * time this process spent per message (Pd's side, including --thread's
+ * I/O thread; the echo child is not counted). Flags after `--` are given
+ * to [node], e.g. `-- --json` or `-- --thread`.
+ */
+
+#include "m_pd.h"
+#include "pd_stub.h"
+#include "instance_stats.h"
+#include <sys/resource.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" void node_setup(void);
+
+using pdnode::Histogram;
+using pdnode::InstanceStats;
+
+namespace {
+
+struct Options {
+    size_t count = 100000;
+    size_t window = 64;
+    size_t list_size = 256;
+    size_t warmup = 1000;
+    std::vector<t_atom> node_args;
+};
+
+struct Scenario {
+    const char *name;
+    void (*send)(t_pd *x, size_t i, const Options& options);
+};
+
+// State shared with the outlet hook
+struct Run {
+    t_pd *object = nullptr;
+    std::vector<uint64_t> sent_us;
+    size_t received = 0;
+    Histogram latency;  // Microseconds
+};
+
+void on_outlet(void *data, t_object *owner, int index, t_symbol *s, int argc, t_atom *argv) {
+    Run& run = *static_cast<Run *>(data);
+    if ((t_pd *)owner != run.object || index != 0 || run.received >= run.sent_us.size()) {
+        return;
+    }
+    // The echo keeps the order: this answers the oldest message in flight
+    run.latency.record(InstanceStats::now_us() - run.sent_us[run.received]);
+    run.received++;
+}
+
+void send_float(t_pd *x, size_t i, const Options& options) {
+    pd_float(x, (t_float)i);
+}
+
+void send_symbol(t_pd *x, size_t i, const Options& options) {
+    static t_symbol *symbols[16];
+    if (!symbols[0]) {
+        for (int k = 0; k < 16; k++) {
+            symbols[k] = gensym(("symbol-" + std::to_string(k)).c_str());
+        }
+    }
+    pd_symbol(x, symbols[i % 16]);
+}
+
+void send_list(t_pd *x, size_t i, const Options& options) {
+    static std::vector<t_atom> atoms;
+    atoms.resize(options.list_size);
+    for (size_t k = 0; k < atoms.size(); k++) {
+        SETFLOAT(&atoms[k], (t_float)(i + k));
+    }
+    pd_list(x, &s_list, (int)atoms.size(), atoms.data());
+}
+
+double cpu_seconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+/**
+ * Send `count` messages with at most `window` unanswered. Returns false
+ * if the answers stopped coming.
+ */
+bool pump_messages(Run& run, const Scenario& scenario, const Options& options, size_t count) {
+    run.sent_us.assign(count, 0);
+    run.received = 0;
+    run.latency.reset();
+    
+    size_t sent = 0;
+    uint64_t last_progress = InstanceStats::now_us();
+    size_t last_received = 0;
+    while (run.received < count) {
+        while (sent < count && sent - run.received < options.window) {
+            run.sent_us[sent] = InstanceStats::now_us();
+            scenario.send(run.object, sent, options);
+            sent++;
+        }
+        stub_pump(100);
+        
+        uint64_t now = InstanceStats::now_us();
+        if (run.received != last_received) {
+            last_received = run.received;
+            last_progress = now;
+        } else if (now - last_progress > 5000000) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * [node] drops messages until its child is ready: probe until one comes
+ * back, then give late answers to earlier probes time to arrive
+ */
+bool wait_until_ready(Run& run) {
+    run.sent_us.clear();
+    run.received = 0;
+    uint64_t start = InstanceStats::now_us();
+    while (run.received == 0) {
+        if (InstanceStats::now_us() - start > 5000000) {
+            return false;
+        }
+        run.sent_us.push_back(InstanceStats::now_us());
+        pd_float(run.object, 0);
+        stub_pump(10);
+    }
+    uint64_t settle = InstanceStats::now_us();
+    while (InstanceStats::now_us() - settle < 50000) {
+        stub_pump(10);
+    }
+    return true;
+}
+
+bool run_scenario(const Scenario& scenario, const Options& options, Run& run) {
+    std::vector<t_atom> args = options.node_args;
+    t_atom script;
+    SETSYMBOL(&script, gensym("/bench/echo.js"));  // Never read by the echo runtime
+    args.push_back(script);
+    
+    run.object = stub_create("node", (int)args.size(), args.data());
+    if (!run.object) {
+        fprintf(stderr, "pd_node_bench: could not create [node]\n");
+        return false;
+    }
+    
+    bool ok = wait_until_ready(run) && pump_messages(run, scenario, options, options.warmup);
+    double cpu_start = cpu_seconds();
+    uint64_t start = InstanceStats::now_us();
+    ok = ok && pump_messages(run, scenario, options, options.count);
+    double elapsed = (InstanceStats::now_us() - start) / 1e6;
+    double cpu = cpu_seconds() - cpu_start;
+    
+    if (ok) {
+        const Histogram& latency = run.latency;
+        printf("%-8s %10zu %12.0f %9.0f %9.0f %9.0f %9.0f %11.2f\n",
+               scenario.name, options.count, options.count / elapsed,
+               (double)latency.percentile(0.5), (double)latency.percentile(0.99),
+               (double)latency.percentile(0.999), (double)latency.max(),
+               cpu * 1e6 / options.count);
+    } else {
+        fprintf(stderr, "pd_node_bench: %s: no answer from the echo runtime (%zu of %zu)\n",
+                scenario.name, run.received, run.sent_us.size());
+    }
+    pd_free(run.object);
+    run.object = nullptr;
+    return ok;
+}
+
+bool parse_size(const char *text, size_t& value) {
+    char *end;
+    long parsed = strtol(text, &end, 10);
+    if (*end != '\0' || parsed <= 0) {
+        return false;
+    }
+    value = (size_t)parsed;
+    return true;
+}
+
+void usage() {
+    fprintf(stderr, "usage: pd_node_bench [--count n] [--window n] [--list n] [-- node flags]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--") == 0) {
+            // The rest is for [node]: numbers as floats, like in a patch
+            for (i++; i < argc; i++) {
+                t_atom atom;
+                size_t number;
+                if (parse_size(argv[i], number)) {
+                    SETFLOAT(&atom, (t_float)number);
+                } else {
+                    SETSYMBOL(&atom, gensym(argv[i]));
+                }
+                options.node_args.push_back(atom);
+            }
+            break;
+        }
+        size_t* value = strcmp(arg, "--count") == 0 ? &options.count
+                      : strcmp(arg, "--window") == 0 ? &options.window
+                      : strcmp(arg, "--list") == 0 ? &options.list_size
+                      : nullptr;
+        if (!value || i + 1 >= argc || !parse_size(argv[i + 1], *value)) {
+            usage();
+            return 2;
+        }
+        i++;
+    }
+    
+    // The echo runtime replaces Bun; no pool so every object gets its own child
+    setenv("PD_NODE_RUNTIME", PD_NODE_ECHO_RUNTIME, 0);
+    setenv("PD_NODE_POOL_SIZE", "0", 1);
+    stub_set_verbose(getenv("PD_NODE_BENCH_VERBOSE") != nullptr);
+    node_setup();
+    
+    Run run;
+    stub_set_outlet_hook(on_outlet, &run);
+    
+    static const Scenario scenarios[] = {
+        { "float", send_float },
+        { "symbol", send_symbol },
+        { "list", send_list }
+    };
+    printf("%-8s %10s %12s %9s %9s %9s %9s %11s\n",
+           "message", "count", "msg/s", "p50 us", "p99 us", "p99.9 us", "max us", "cpu us/msg");
+    int failures = 0;
+    for (const Scenario& scenario : scenarios) {
+        if (!run_scenario(scenario, options, run)) {
+            failures++;
+        }
+    }
+    printf("(list: %zu floats, window: %zu)\n", options.list_size, options.window);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * echo_runtime.cpp
+ * 
+ * Stand-in for Bun + wrapper.js that sends every inlet message straight
+ * back to the first outlet, so the benchmark measures the bridge and not
+ * a JavaScript engine. Speaks both framings over the pipes; it never
+ * attaches the shared memory rings, so --shm stays on the pipes.
+ */
+
+#include "frame.h"
+#include "json.hpp"
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace pdnode;
+using json = nlohmann::json;
+
+static bool write_all(const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(STDOUT_FILENO, data.data() + done, data.size() - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static void append_frame(std::string& out, FrameType type, uint16_t port, const FrameExtensions& ext,
+                         const char* payload, size_t size) {
+    char header[kFrameHeaderSize];
+    char extensions[kMaxFrameExtensionSize];
+    size_t ext_size = encode_frame_extensions(extensions, ext);
+    encode_frame_header(header, { static_cast<uint32_t>(ext_size + size), type,
+                                  frame_extension_flags(ext), port });
+    out.append(header, kFrameHeaderSize);
+    out.append(extensions, ext_size);
+    out.append(payload, size);
+}
+
+// Binary framing: a MESSAGE payload is already a valid OUTLET payload
+static size_t echo_frames(const std::string& in, std::string& out) {
+    size_t pos = 0;
+    while (in.size() - pos >= kFrameHeaderSize) {
+        FrameHeader header = decode_frame_header(in.data() + pos);
+        if (header.length > kMaxFrameLength) {
+            fprintf(stderr, "[echo] Bad frame length %u\n", header.length);
+            exit(1);
+        }
+        if (in.size() - pos - kFrameHeaderSize < header.length) {
+            break;
+        }
+        FrameView frame = { header.type, header.flags, header.port,
+                            in.data() + pos + kFrameHeaderSize, header.length, 0, 0, 0 };
+        pos += kFrameHeaderSize + header.length;
+        if (frame.type != FrameType::MESSAGE || !decode_frame_extensions(frame)) {
+            continue;  // LOAD, UNLOAD, ARRAY: nothing to do
+        }
+        
+        // The time stamp would schedule the reply: leave it off
+        FrameExtensions ext;
+        ext.channel = frame.channel;
+        ext.seq = frame.seq;
+        append_frame(out, FrameType::OUTLET, 0, ext, frame.data, frame.size);
+    }
+    return pos;
+}
+
+// Newline-delimited JSON framing
+static size_t echo_lines(const std::string& in, std::string& out) {
+    size_t pos = 0;
+    size_t eol;
+    while ((eol = in.find('\n', pos)) != std::string::npos) {
+        json msg = json::parse(in.begin() + pos, in.begin() + eol, nullptr, false);
+        pos = eol + 1;
+        if (msg.is_discarded() || msg.value("type", "") != "message") {
+            continue;
+        }
+        json reply = {
+            {"type", "outlet"},
+            {"outlet", 0},
+            {"selector", msg.value("selector", "list")},
+            {"args", msg.value("args", json::array())}
+        };
+        for (const char* key : { "channel", "seq" }) {
+            if (msg.contains(key)) {
+                reply[key] = msg[key];
+            }
+        }
+        out += reply.dump();
+        out += '\n';
+    }
+    return pos;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--version") == 0) {
+        printf("echo-runtime %s\n", PD_NODE_VERSION);
+        return 0;
+    }
+    const char* framing = getenv("PD_NODE_FRAMING");
+    bool binary = framing && strcmp(framing, "binary") == 0;
+    
+    std::string ready = R"({"type":"ready","transport":"pipe"})";
+    std::string out;
+    if (binary) {
+        append_frame(out, FrameType::READY, 0, FrameExtensions(), ready.data(), ready.size());
+    } else {
+        out = ready + '\n';
+    }
+    if (!write_all(out)) {
+        return 1;
+    }
+    
+    // Answer everything read in one go with one write, like wrapper.js
+    std::string in;
+    std::vector<char> buffer(1 << 16);
+    for (;;) {
+        ssize_t n = read(STDIN_FILENO, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 0;  // Pd closed the pipe
+        }
+        in.append(buffer.data(), static_cast<size_t>(n));
+        
+        out.clear();
+        size_t used = binary ? echo_frames(in, out) : echo_lines(in, out);
+        in.erase(0, used);
+        if (!out.empty() && !write_all(out)) {
+            return 1;
+        }
+    }
+}
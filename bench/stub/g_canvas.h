@@ -0,0 +1,23 @@
+/**
+ * g_canvas.h
+ * 
+ * Stand-in for Pd's canvas header (see m_pd.h)
+ */
+
+#ifndef __g_canvas_h_
+#define __g_canvas_h_
+
+#include "m_pd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+EXTERN t_canvas *canvas_getcurrent(void);
+EXTERN void canvas_makefilename(const t_glist *c, const char *file, char *result, int resultsize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __g_canvas_h_ */
@@ -0,0 +1,189 @@
+/**
+ * m_pd.h
+ * 
+ * Stand-in for Pd's public header, just what the external uses, so the
+ * bridge can be benchmarked without Pd. Types and signatures follow
+ * Pd 0.54; layouts only match where the external looks inside.
+ */
+
+#ifndef __m_pd_h_
+#define __m_pd_h_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAXPDSTRING 1000
+#define EXTERN extern
+
+typedef float t_float;
+typedef float t_floatarg;
+typedef float t_sample;
+typedef long t_int;
+
+struct _class;
+struct _outlet;
+struct _inlet;
+struct _clock;
+struct _glist;
+struct _garray;
+
+typedef struct _symbol {
+    const char *s_name;
+    struct _class **s_thing;
+    struct _symbol *s_next;
+} t_symbol;
+
+typedef enum {
+    A_NULL, A_FLOAT, A_SYMBOL, A_POINTER, A_SEMI, A_COMMA, A_DEFFLOAT,
+    A_DEFSYM, A_DOLLAR, A_DOLLSYM, A_GIMME, A_CANT
+} t_atomtype;
+
+typedef union word {
+    t_float w_float;
+    t_symbol *w_symbol;
+    void *w_gpointer;
+    int w_index;
+} t_word;
+
+typedef struct _atom {
+    t_atomtype a_type;
+    union word a_w;
+} t_atom;
+
+typedef struct _class *t_pd;
+
+typedef struct _gobj {
+    t_pd g_pd;
+    struct _gobj *g_next;
+} t_gobj;
+
+typedef struct _text {
+    t_gobj te_g;
+    void *te_binbuf;
+    struct _outlet *te_outlet;
+    struct _inlet *te_inlet;
+    short te_xpix, te_ypix, te_width;
+    unsigned int te_type:2;
+} t_text;
+
+typedef t_text t_object;
+#define ob_pd te_g.g_pd
+
+typedef struct _outlet t_outlet;
+typedef struct _inlet t_inlet;
+typedef struct _clock t_clock;
+typedef struct _glist t_glist;
+typedef struct _glist t_canvas;
+typedef struct _garray t_garray;
+typedef struct _class t_class;
+
+typedef void (*t_method)(void);
+typedef void *(*t_newmethod)(void);
+typedef t_int *(*t_perfroutine)(t_int *args);
+typedef void (*t_fdpollfn)(void *ptr, int fd);
+
+typedef struct _signal {
+    int s_n;
+    t_sample *s_vec;
+    t_float s_sr;
+    int s_refcount;
+    int s_isborrowed;
+    struct _signal *s_borrowedfrom;
+    struct _signal *s_nextfree;
+    struct _signal *s_nextused;
+    int s_vecsize;
+} t_signal;
+
+EXTERN t_symbol s_bang, s_float, s_symbol, s_list, s_anything, s_signal, s_;
+
+/* Classes and objects */
+
+#define CLASS_DEFAULT 0
+#define CLASS_MAINSIGNALIN(c, type, field) \
+    class_domainsignalin(c, (int)offsetof(type, field))
+
+EXTERN t_symbol *gensym(const char *s);
+EXTERN t_pd *pd_new(t_class *cls);
+EXTERN void pd_free(t_pd *x);
+EXTERN t_class *class_new(t_symbol *name, t_newmethod newmethod, t_method freemethod,
+    size_t size, int flags, t_atomtype arg1, ...);
+EXTERN void class_addmethod(t_class *c, t_method fn, t_symbol *sel, t_atomtype arg1, ...);
+EXTERN void class_addbang(t_class *c, t_method fn);
+EXTERN void class_addfloat(t_class *c, t_method fn);
+EXTERN void class_addsymbol(t_class *c, t_method fn);
+EXTERN void class_addlist(t_class *c, t_method fn);
+EXTERN void class_addanything(t_class *c, t_method fn);
+EXTERN void class_domainsignalin(t_class *c, int onset);
+EXTERN void class_sethelpsymbol(t_class *c, t_symbol *s);
+EXTERN const char *class_gethelpdir(const t_class *c);
+
+#define class_addbang(x, y) class_addbang((x), (t_method)(y))
+#define class_addfloat(x, y) class_addfloat((x), (t_method)(y))
+#define class_addsymbol(x, y) class_addsymbol((x), (t_method)(y))
+#define class_addlist(x, y) class_addlist((x), (t_method)(y))
+#define class_addanything(x, y) class_addanything((x), (t_method)(y))
+
+/* Messages into an object */
+
+EXTERN void pd_bang(t_pd *x);
+EXTERN void pd_float(t_pd *x, t_float f);
+EXTERN void pd_symbol(t_pd *x, t_symbol *s);
+EXTERN void pd_list(t_pd *x, t_symbol *s, int argc, t_atom *argv);
+EXTERN void pd_typedmess(t_pd *x, t_symbol *s, int argc, t_atom *argv);
+EXTERN t_pd *pd_findbyclass(t_symbol *s, const t_class *c);
+
+/* Console */
+
+EXTERN void post(const char *fmt, ...);
+EXTERN void pd_error(const void *object, const char *fmt, ...);
+
+/* Inlets and outlets */
+
+EXTERN t_outlet *outlet_new(t_object *owner, t_symbol *s);
+EXTERN void outlet_bang(t_outlet *x);
+EXTERN void outlet_float(t_outlet *x, t_float f);
+EXTERN void outlet_symbol(t_outlet *x, t_symbol *s);
+EXTERN void outlet_list(t_outlet *x, t_symbol *s, int argc, t_atom *argv);
+EXTERN void outlet_anything(t_outlet *x, t_symbol *s, int argc, t_atom *argv);
+EXTERN t_inlet *inlet_new(t_object *owner, t_pd *dest, t_symbol *s1, t_symbol *s2);
+
+/* Atoms */
+
+EXTERN t_float atom_getfloat(const t_atom *a);
+EXTERN t_symbol *atom_getsymbol(const t_atom *a);
+
+#define SETFLOAT(atom, f) ((atom)->a_type = A_FLOAT, (atom)->a_w.w_float = (f))
+#define SETSYMBOL(atom, s) ((atom)->a_type = A_SYMBOL, (atom)->a_w.w_symbol = (s))
+
+/* Scheduler */
+
+EXTERN t_clock *clock_new(void *owner, t_method fn);
+EXTERN void clock_set(t_clock *x, double systime);
+EXTERN void clock_delay(t_clock *x, double delaytime);
+EXTERN void clock_free(t_clock *x);
+EXTERN double clock_gettimesince(double prevsystime);
+EXTERN double clock_getsystimeafter(double delaytime);
+
+EXTERN void sys_addpollfn(int fd, t_fdpollfn fn, void *ptr);
+EXTERN void sys_rmpollfn(int fd);
+
+/* DSP */
+
+EXTERN void dsp_addv(t_perfroutine f, int n, t_int *vec);
+EXTERN t_float sys_getsr(void);
+EXTERN int sys_getblksize(void);
+
+/* Arrays */
+
+EXTERN t_class *garray_class;
+EXTERN int garray_getfloatwords(t_garray *x, int *size, t_word **vec);
+EXTERN void garray_redraw(t_garray *x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __m_pd_h_ */
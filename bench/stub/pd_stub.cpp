@@ -0,0 +1,462 @@
+/**
+ * pd_stub.cpp
+ * 
+ * Just enough of Pd to create [node] objects, send them messages and run
+ * their clocks and file descriptor callbacks, all on one thread
+ */
+
+#include "m_pd.h"
+#include "g_canvas.h"
+#include "pd_stub.h"
+#include <poll.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct _class {
+    t_symbol *name;
+    t_newmethod newmethod;
+    t_method freemethod;
+    size_t size;
+    t_method bang;
+    t_method float_method;
+    t_method symbol;
+    t_method list;
+    t_method anything;
+    
+    struct Method {
+        t_method fn;
+        t_atomtype arg;  // First argument; enough for the external's methods
+    };
+    std::map<t_symbol*, Method> methods;
+};
+
+struct _outlet {
+    t_object *owner;
+    int index;
+};
+
+struct _clock {
+    void *owner;
+    t_method fn;
+    double when;
+    bool set;
+};
+
+t_symbol s_bang = { "bang", nullptr, nullptr };
+t_symbol s_float = { "float", nullptr, nullptr };
+t_symbol s_symbol = { "symbol", nullptr, nullptr };
+t_symbol s_list = { "list", nullptr, nullptr };
+t_symbol s_anything = { "anything", nullptr, nullptr };
+t_symbol s_signal = { "signal", nullptr, nullptr };
+t_symbol s_ = { "", nullptr, nullptr };
+
+t_class *garray_class = nullptr;
+
+namespace {
+
+struct PollEntry {
+    int fd;
+    t_fdpollfn fn;
+    void *ptr;
+};
+
+struct Stub {
+    std::unordered_map<std::string, t_symbol*> symbols;
+    std::map<std::string, t_class*> classes;
+    std::map<t_object*, std::vector<t_outlet*>> outlets;
+    std::vector<t_clock*> clocks;
+    std::vector<PollEntry> polls;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::string helpdir = ".";
+    bool verbose = true;
+    t_stub_outlet_hook hook = nullptr;
+    void *hook_data = nullptr;
+};
+
+Stub& stub() {
+    static Stub instance;
+    return instance;
+}
+
+// Logical time in ms: the wall clock since the stub started
+double now_ms() {
+    auto elapsed = std::chrono::steady_clock::now() - stub().start;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+void emit(t_outlet *x, t_symbol *s, int argc, t_atom *argv) {
+    Stub& st = stub();
+    if (st.hook) {
+        st.hook(st.hook_data, x->owner, x->index, s, argc, argv);
+    }
+}
+
+} // namespace
+
+/* Bench hooks */
+
+void stub_set_outlet_hook(t_stub_outlet_hook hook, void *data) {
+    stub().hook = hook;
+    stub().hook_data = data;
+}
+
+void stub_set_helpdir(const char *dir) {
+    stub().helpdir = dir;
+}
+
+void stub_set_verbose(int verbose) {
+    stub().verbose = verbose != 0;
+}
+
+t_pd *stub_create(const char *name, int argc, t_atom *argv) {
+    auto it = stub().classes.find(name);
+    if (it == stub().classes.end()) {
+        return nullptr;
+    }
+    typedef void *(*t_gimme_new)(t_symbol *s, int argc, t_atom *argv);
+    t_class *c = it->second;
+    return (t_pd *)((t_gimme_new)(t_method)c->newmethod)(c->name, argc, argv);
+}
+
+void stub_pump(double timeout_ms) {
+    Stub& st = stub();
+    
+    // Clocks first, in due order; one armed while firing waits for the next tick
+    double now = now_ms();
+    std::vector<t_clock*> due;
+    for (t_clock *clock : st.clocks) {
+        if (clock->set && clock->when <= now) {
+            due.push_back(clock);
+        }
+    }
+    std::stable_sort(due.begin(), due.end(), [](t_clock *a, t_clock *b) { return a->when < b->when; });
+    for (t_clock *clock : due) {
+        // An earlier callback may have unset or freed it
+        if (std::find(st.clocks.begin(), st.clocks.end(), clock) != st.clocks.end()
+            && clock->set && clock->when <= now) {
+            clock->set = false;
+            ((void (*)(void *))clock->fn)(clock->owner);
+        }
+    }
+    
+    double wait = timeout_ms;
+    now = now_ms();
+    for (t_clock *clock : st.clocks) {
+        if (clock->set) {
+            wait = std::min(wait, clock->when - now);
+        }
+    }
+    int wait_ms = wait <= 0 ? 0 : (int)(wait + 0.999);
+    
+    std::vector<pollfd> fds;
+    for (const PollEntry& entry : st.polls) {
+        fds.push_back({ entry.fd, POLLIN, 0 });
+    }
+    if (poll(fds.data(), fds.size(), wait_ms) <= 0) {
+        return;
+    }
+    for (const pollfd& fd : fds) {
+        if (!fd.revents) {
+            continue;
+        }
+        // Handlers may remove entries (e.g. when the child exits)
+        for (const PollEntry& entry : st.polls) {
+            if (entry.fd == fd.fd) {
+                PollEntry call = entry;
+                call.fn(call.ptr, call.fd);
+                break;
+            }
+        }
+    }
+}
+
+/* Classes and objects */
+
+t_symbol *gensym(const char *s) {
+    auto& symbols = stub().symbols;
+    auto it = symbols.find(s);
+    if (it != symbols.end()) {
+        return it->second;
+    }
+    t_symbol *sym = new t_symbol{ strdup(s), nullptr, nullptr };
+    symbols.emplace(s, sym);
+    return sym;
+}
+
+t_pd *pd_new(t_class *cls) {
+    t_pd *x = (t_pd *)calloc(1, cls->size);
+    *x = cls;
+    return x;
+}
+
+void pd_free(t_pd *x) {
+    t_class *c = *x;
+    if (c->freemethod) {
+        ((void (*)(t_pd *))c->freemethod)(x);
+    }
+    auto it = stub().outlets.find((t_object *)x);
+    if (it != stub().outlets.end()) {
+        for (t_outlet *outlet : it->second) {
+            delete outlet;
+        }
+        stub().outlets.erase(it);
+    }
+    free(x);
+}
+
+t_class *class_new(t_symbol *name, t_newmethod newmethod, t_method freemethod,
+    size_t size, int flags, t_atomtype arg1, ...) {
+    t_class *c = new t_class();
+    c->name = name;
+    c->newmethod = newmethod;
+    c->freemethod = freemethod;
+    c->size = size;
+    stub().classes[name->s_name] = c;
+    return c;
+}
+
+void class_addmethod(t_class *c, t_method fn, t_symbol *sel, t_atomtype arg1, ...) {
+    c->methods[sel] = { fn, arg1 };
+}
+
+#undef class_addbang
+#undef class_addfloat
+#undef class_addsymbol
+#undef class_addlist
+#undef class_addanything
+
+void class_addbang(t_class *c, t_method fn) { c->bang = fn; }
+void class_addfloat(t_class *c, t_method fn) { c->float_method = fn; }
+void class_addsymbol(t_class *c, t_method fn) { c->symbol = fn; }
+void class_addlist(t_class *c, t_method fn) { c->list = fn; }
+void class_addanything(t_class *c, t_method fn) { c->anything = fn; }
+void class_domainsignalin(t_class *c, int onset) {}
+void class_sethelpsymbol(t_class *c, t_symbol *s) {}
+
+const char *class_gethelpdir(const t_class *c) {
+    return stub().helpdir.c_str();
+}
+
+/* Messages into an object */
+
+typedef void (*t_stub_bang)(t_pd *x);
+typedef void (*t_stub_float)(t_pd *x, t_float f);
+typedef void (*t_stub_symbol)(t_pd *x, t_symbol *s);
+typedef void (*t_stub_gimme)(t_pd *x, t_symbol *s, int argc, t_atom *argv);
+
+void pd_typedmess(t_pd *x, t_symbol *s, int argc, t_atom *argv) {
+    t_class *c = *x;
+    auto it = c->methods.find(s);
+    if (it != c->methods.end()) {
+        const t_class::Method& method = it->second;
+        switch (method.arg) {
+            case A_NULL:
+                ((t_stub_bang)method.fn)(x);
+                return;
+            case A_FLOAT:
+            case A_DEFFLOAT:
+                ((t_stub_float)method.fn)(x, argc > 0 ? atom_getfloat(argv) : 0);
+                return;
+            case A_SYMBOL:
+            case A_DEFSYM:
+                ((t_stub_symbol)method.fn)(x, argc > 0 ? atom_getsymbol(argv) : &s_);
+                return;
+            case A_GIMME:
+                ((t_stub_gimme)method.fn)(x, s, argc, argv);
+                return;
+            default:
+                pd_error(x, "stub: can't call method '%s'", s->s_name);
+                return;
+        }
+    }
+    if (s == &s_bang && c->bang) {
+        ((t_stub_bang)c->bang)(x);
+    } else if (s == &s_float && argc > 0 && c->float_method) {
+        ((t_stub_float)c->float_method)(x, atom_getfloat(argv));
+    } else if (s == &s_symbol && argc > 0 && c->symbol) {
+        ((t_stub_symbol)c->symbol)(x, atom_getsymbol(argv));
+    } else if (s == &s_list && c->list) {
+        ((t_stub_gimme)c->list)(x, s, argc, argv);
+    } else if (c->anything) {
+        ((t_stub_gimme)c->anything)(x, s, argc, argv);
+    } else {
+        pd_error(x, "stub: no method for '%s'", s->s_name);
+    }
+}
+
+void pd_bang(t_pd *x) {
+    pd_typedmess(x, &s_bang, 0, nullptr);
+}
+
+void pd_float(t_pd *x, t_float f) {
+    t_atom a;
+    SETFLOAT(&a, f);
+    pd_typedmess(x, &s_float, 1, &a);
+}
+
+void pd_symbol(t_pd *x, t_symbol *s) {
+    t_atom a;
+    SETSYMBOL(&a, s);
+    pd_typedmess(x, &s_symbol, 1, &a);
+}
+
+void pd_list(t_pd *x, t_symbol *s, int argc, t_atom *argv) {
+    pd_typedmess(x, &s_list, argc, argv);
+}
+
+t_pd *pd_findbyclass(t_symbol *s, const t_class *c) {
+    return nullptr;  // No arrays here
+}
+
+/* Console */
+
+void post(const char *fmt, ...) {
+    if (!stub().verbose) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+void pd_error(const void *object, const char *fmt, ...) {
+    if (!stub().verbose) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    fputs("error: ", stderr);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+/* Inlets and outlets */
+
+t_outlet *outlet_new(t_object *owner, t_symbol *s) {
+    std::vector<t_outlet*>& outlets = stub().outlets[owner];
+    t_outlet *outlet = new t_outlet{ owner, (int)outlets.size() };
+    outlets.push_back(outlet);
+    return outlet;
+}
+
+void outlet_bang(t_outlet *x) {
+    emit(x, &s_bang, 0, nullptr);
+}
+
+void outlet_float(t_outlet *x, t_float f) {
+    t_atom a;
+    SETFLOAT(&a, f);
+    emit(x, &s_float, 1, &a);
+}
+
+void outlet_symbol(t_outlet *x, t_symbol *s) {
+    t_atom a;
+    SETSYMBOL(&a, s);
+    emit(x, &s_symbol, 1, &a);
+}
+
+void outlet_list(t_outlet *x, t_symbol *s, int argc, t_atom *argv) {
+    emit(x, &s_list, argc, argv);
+}
+
+void outlet_anything(t_outlet *x, t_symbol *s, int argc, t_atom *argv) {
+    emit(x, s, argc, argv);
+}
+
+t_inlet *inlet_new(t_object *owner, t_pd *dest, t_symbol *s1, t_symbol *s2) {
+    return nullptr;  // Only the left inlet is used
+}
+
+/* Atoms */
+
+t_float atom_getfloat(const t_atom *a) {
+    return a->a_type == A_FLOAT ? a->a_w.w_float : 0;
+}
+
+t_symbol *atom_getsymbol(const t_atom *a) {
+    return a->a_type == A_SYMBOL ? a->a_w.w_symbol : &s_;
+}
+
+/* Scheduler */
+
+t_clock *clock_new(void *owner, t_method fn) {
+    t_clock *clock = new t_clock{ owner, fn, 0, false };
+    stub().clocks.push_back(clock);
+    return clock;
+}
+
+void clock_delay(t_clock *x, double delaytime) {
+    x->when = now_ms() + (delaytime > 0 ? delaytime : 0);
+    x->set = true;
+}
+
+// The stub's systime is simply logical time in ms
+void clock_set(t_clock *x, double systime) {
+    x->when = systime;
+    x->set = true;
+}
+
+void clock_free(t_clock *x) {
+    auto& clocks = stub().clocks;
+    clocks.erase(std::remove(clocks.begin(), clocks.end(), x), clocks.end());
+    delete x;
+}
+
+double clock_gettimesince(double prevsystime) {
+    return now_ms() - prevsystime;
+}
+
+double clock_getsystimeafter(double delaytime) {
+    return now_ms() + delaytime;
+}
+
+void sys_addpollfn(int fd, t_fdpollfn fn, void *ptr) {
+    stub().polls.push_back({ fd, fn, ptr });
+}
+
+void sys_rmpollfn(int fd) {
+    auto& polls = stub().polls;
+    polls.erase(std::remove_if(polls.begin(), polls.end(),
+        [fd](const PollEntry& entry) { return entry.fd == fd; }), polls.end());
+}
+
+/* DSP: never started here */
+
+void dsp_addv(t_perfroutine f, int n, t_int *vec) {}
+
+t_float sys_getsr(void) {
+    return 44100;
+}
+
+int sys_getblksize(void) {
+    return 64;
+}
+
+/* Arrays: there are none */
+
+int garray_getfloatwords(t_garray *x, int *size, t_word **vec) {
+    return 0;
+}
+
+void garray_redraw(t_garray *x) {}
+
+/* Canvas */
+
+t_canvas *canvas_getcurrent(void) {
+    return nullptr;
+}
+
+void canvas_makefilename(const t_glist *c, const char *file, char *result, int resultsize) {
+    snprintf(result, resultsize, "%s", file);
+}
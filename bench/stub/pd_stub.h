@@ -0,0 +1,44 @@
+/**
+ * pd_stub.h
+ * 
+ * What the benchmark needs from the stand-in Pd beyond Pd's own API
+ */
+
+#ifndef PD_NODE_PD_STUB_H
+#define PD_NODE_PD_STUB_H
+
+#include "m_pd.h"
+
+/**
+ * Called for everything an object sends from an outlet; `index` counts
+ * the owner's outlets from 0 in creation order
+ */
+typedef void (*t_stub_outlet_hook)(void *data, t_object *owner, int index,
+    t_symbol *s, int argc, t_atom *argv);
+
+void stub_set_outlet_hook(t_stub_outlet_hook hook, void *data);
+
+/**
+ * Directory reported by class_gethelpdir() (where wrapper.js would be)
+ */
+void stub_set_helpdir(const char *dir);
+
+/**
+ * Print post() and pd_error() text to stderr (default on)
+ */
+void stub_set_verbose(int verbose);
+
+/**
+ * Create an object of a class registered by name, as if typed into a
+ * patch (nullptr if the class is unknown or creation failed)
+ */
+t_pd *stub_create(const char *name, int argc, t_atom *argv);
+
+/**
+ * One scheduler tick: fire due clocks, then wait up to `timeout_ms` for
+ * polled file descriptors and call their handlers. Logical time follows
+ * the wall clock.
+ */
+void stub_pump(double timeout_ms);
+
+#endif // PD_NODE_PD_STUB_H
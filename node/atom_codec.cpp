@@ -0,0 +1,113 @@
+/**
+ * atom_codec.cpp
+ * 
+ * Compact binary encoding of Pd messages
+ */
+
+#include "atom_codec.h"
+#include <cstring>
+
+namespace pdnode {
+
+void AtomWriter::add_float(float f) {
+    char bytes[5];
+    bytes[0] = static_cast<char>(AtomTag::FLOAT);
+    std::memcpy(bytes + 1, &f, 4);
+    out_.append(bytes, 5);
+}
+
+void AtomWriter::add_symbol(const char* str, size_t len) {
+    if (len > 0xFFFF) {
+        len = 0xFFFF;
+    }
+    char bytes[3];
+    bytes[0] = static_cast<char>(AtomTag::SYMBOL);
+    bytes[1] = static_cast<char>(len & 0xFF);
+    bytes[2] = static_cast<char>(len >> 8);
+    out_.append(bytes, 3);
+    out_.append(str, len);
+}
+
+void AtomWriter::begin_float_array(uint32_t count) {
+    char bytes[5];
+    bytes[0] = static_cast<char>(AtomTag::FLOAT_ARRAY);
+    std::memcpy(bytes + 1, &count, 4);
+    out_.reserve(out_.size() + 5 + count * 4);
+    out_.append(bytes, 5);
+}
+
+bool AtomReader::next(AtomEntry& entry) {
+    if (pos_ >= end_) {
+        return false;
+    }
+    
+    entry.tag = static_cast<AtomTag>(static_cast<unsigned char>(*pos_++));
+    switch (entry.tag) {
+        case AtomTag::FLOAT:
+            if (end_ - pos_ < 4) {
+                break;
+            }
+            std::memcpy(&entry.f, pos_, 4);
+            pos_ += 4;
+            return true;
+            
+        case AtomTag::SYMBOL_REF: {
+            if (end_ - pos_ < 2) {
+                break;
+            }
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(pos_);
+            entry.id = static_cast<uint16_t>(p[0] | (p[1] << 8));
+            pos_ += 2;
+            return true;
+        }
+            
+        case AtomTag::SYMBOL_DEF:
+        case AtomTag::SYMBOL: {
+            size_t header = (entry.tag == AtomTag::SYMBOL_DEF) ? 4 : 2;
+            if (static_cast<size_t>(end_ - pos_) < header) {
+                break;
+            }
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(pos_);
+            if (entry.tag == AtomTag::SYMBOL_DEF) {
+                entry.id = static_cast<uint16_t>(p[0] | (p[1] << 8));
+                p += 2;
+            }
+            size_t len = p[0] | (p[1] << 8);
+            pos_ += header;
+            if (static_cast<size_t>(end_ - pos_) < len) {
+                break;
+            }
+            entry.str = pos_;
+            entry.len = len;
+            pos_ += len;
+            return true;
+        }
+            
+        case AtomTag::FLOAT_ARRAY: {
+            uint32_t count;
+            if (end_ - pos_ < 4) {
+                break;
+            }
+            std::memcpy(&count, pos_, 4);
+            pos_ += 4;
+            if (static_cast<size_t>(end_ - pos_) / 4 < count) {
+                break;
+            }
+            entry.str = pos_;
+            entry.len = count;
+            pos_ += static_cast<size_t>(count) * 4;
+            return true;
+        }
+            
+        case AtomTag::SEL_BANG:
+        case AtomTag::SEL_FLOAT:
+        case AtomTag::SEL_SYMBOL:
+        case AtomTag::SEL_LIST:
+            return true;
+    }
+    
+    ok_ = false;
+    return false;
+}
+
+} // namespace pdnode
@@ -0,0 +1,112 @@
+/**
+ * atom_codec.h
+ * 
+ * Compact binary encoding of Pd messages, used as the payload of MESSAGE
+ * and OUTLET frames. wrapper.js implements the same format.
+ * 
+ * A payload is a selector entry followed by zero or more atom entries,
+ * each starting with a one-byte tag (little endian values):
+ *   0x01 FLOAT       f32
+ *   0x02 SYMBOL      u16 length, UTF-8 bytes
+ *   0x03 SYMBOL_DEF  u16 id, u16 length, UTF-8 bytes (JS -> Pd)
+ *   0x04 SYMBOL_REF  u16 id (JS -> Pd)
+ *   0x05 FLOAT_ARRAY u32 count, count x f32
+ *   0x10 SEL_BANG    (selector only)
+ *   0x11 SEL_FLOAT   (selector only)
+ *   0x12 SEL_SYMBOL  (selector only)
+ *   0x13 SEL_LIST    (selector only)
+ * Any other selector is written as a SYMBOL entry.
+ * 
+ * Scripts intern the symbols they send: the first use of a string is a
+ * SYMBOL_DEF giving it an id, later uses are a SYMBOL_REF, which Pd maps
+ * to its cached t_symbol* without hashing the text again. Ids are per
+ * channel (per script) and never reused.
+ * 
+ * Runs of at least kFloatArrayMin floats (spectra, grain tables) are sent
+ * as one FLOAT_ARRAY, a contiguous block that is copied rather than parsed
+ * atom by atom.
+ */
+
+#ifndef PD_NODE_ATOM_CODEC_H
+#define PD_NODE_ATOM_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace pdnode {
+
+enum class AtomTag : uint8_t {
+    FLOAT       = 0x01,
+    SYMBOL      = 0x02,
+    SYMBOL_DEF  = 0x03,
+    SYMBOL_REF  = 0x04,
+    FLOAT_ARRAY = 0x05,
+    SEL_BANG    = 0x10,
+    SEL_FLOAT   = 0x11,
+    SEL_SYMBOL  = 0x12,
+    SEL_LIST    = 0x13
+};
+
+/**
+ * One decoded entry. Symbol text points into the payload being read.
+ */
+struct AtomEntry {
+    AtomTag tag;
+    float f;
+    const char* str;
+    size_t len;
+    uint16_t id;    // SYMBOL_DEF, SYMBOL_REF
+    // FLOAT_ARRAY: `len` little endian f32 at `str` (not aligned)
+};
+
+/**
+ * Shortest float list worth packing as a FLOAT_ARRAY
+ */
+static const size_t kFloatArrayMin = 8;
+
+/**
+ * Appends entries to a byte buffer
+ */
+class AtomWriter {
+public:
+    explicit AtomWriter(std::string& out) : out_(out) {}
+    
+    void add_tag(AtomTag tag) { out_.push_back(static_cast<char>(tag)); }
+    void add_float(float f);
+    void add_symbol(const char* str, size_t len);
+    
+    /**
+     * Start a FLOAT_ARRAY; exactly `count` add_array_float() calls follow
+     */
+    void begin_float_array(uint32_t count);
+    void add_array_float(float f) { out_.append(reinterpret_cast<const char*>(&f), 4); }
+    
+private:
+    std::string& out_;
+};
+
+/**
+ * Walks the entries of a payload
+ */
+class AtomReader {
+public:
+    AtomReader(const char* data, size_t len) : pos_(data), end_(data + len), ok_(true) {}
+    
+    /**
+     * Read the next entry. Returns false at the end or on malformed input
+     * (check ok() to tell them apart).
+     */
+    bool next(AtomEntry& entry);
+    
+    bool ok() const { return ok_; }
+    
+private:
+    const char* pos_;
+    const char* end_;
+    bool ok_;
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_ATOM_CODEC_H
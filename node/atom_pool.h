@@ -0,0 +1,99 @@
+/**
+ * atom_pool.h
+ * 
+ * Reusable buffers for the atoms of outgoing messages
+ */
+
+#ifndef PD_NODE_ATOM_POOL_H
+#define PD_NODE_ATOM_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace pdnode {
+
+/**
+ * Atom Pool - per-object buffers for building outlet messages
+ * 
+ * A lease borrows a buffer and gives it back when it goes out of scope, so
+ * once the buffers have grown to the usual message size, emitting touches
+ * neither the allocator nor the stack. Nested leases (a message fed back
+ * into the same object while its outlet is busy) take another buffer.
+ * 
+ * Buffers are kept up to `max_atoms`; a longer message spills into a heap
+ * buffer that is freed right after, so one huge list does not stay
+ * resident. Templated on the atom type to keep Pd out of this header.
+ * Not thread-safe: only used from Pd's main thread.
+ */
+template <typename Atom>
+class AtomPool {
+public:
+    static const size_t kDefaultMax = 4096;
+    
+    class Lease {
+    public:
+        Lease(AtomPool& pool, size_t count) : pool_(pool) {
+            pool_.take(buffer_, count);
+        }
+        ~Lease() { pool_.give(buffer_); }
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        
+        Atom* data() { return buffer_.data(); }
+        size_t size() const { return buffer_.size(); }
+    
+    private:
+        AtomPool& pool_;
+        std::vector<Atom> buffer_;
+    };
+    
+    explicit AtomPool(size_t max_atoms = kDefaultMax) : max_(max_atoms), spills_(0) {
+        free_.reserve(4);
+    }
+    
+    /**
+     * Longest message served from kept buffers
+     */
+    size_t max_atoms() const { return max_; }
+    void set_max_atoms(size_t max_atoms) { max_ = max_atoms; }
+    
+    /**
+     * Messages that were longer than max_atoms()
+     */
+    uint64_t spills() const { return spills_; }
+    
+private:
+    void take(std::vector<Atom>& buffer, size_t count) {
+        if (count > max_) {
+            spills_++;
+        } else if (!free_.empty()) {
+            buffer = std::move(free_.back());
+            free_.pop_back();
+        }
+        if (buffer.capacity() < count) {
+            // Grow geometrically, but not past what give() keeps
+            size_t grown = std::max(count, buffer.capacity() * 2);
+            buffer.reserve(count > max_ ? count : std::min(grown, max_));
+        }
+        buffer.resize(count);
+    }
+    
+    void give(std::vector<Atom>& buffer) {
+        if (buffer.capacity() > max_) {
+            return;  // Spilled (or grown past a lowered max): let it go
+        }
+        buffer.clear();
+        free_.push_back(std::move(buffer));
+    }
+    
+    std::vector<std::vector<Atom>> free_;
+    size_t max_;
+    uint64_t spills_;
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_ATOM_POOL_H
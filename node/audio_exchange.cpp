@@ -0,0 +1,105 @@
+/**
+ * audio_exchange.cpp
+ * 
+ * Signal blocks shared with the script of a [node~]
+ */
+
+#include "audio_exchange.h"
+#include <cstring>
+#include <new>
+
+namespace pdnode {
+
+AudioExchange::AudioExchange(uint32_t inputs, uint32_t outputs, uint32_t slots, uint32_t max_block)
+    : base_(nullptr)
+    , written_(nullptr)
+    , inputs_(inputs)
+    , outputs_(outputs)
+    , slots_(slots)
+    , max_block_(max_block)
+    , block_size_(0)
+    , slot_size_(kSlotHeaderSize + static_cast<size_t>(inputs + outputs) * max_block * sizeof(float))
+    , block_(0)
+    , playing_(0)
+    , underruns_(0)
+{
+}
+
+size_t AudioExchange::region_size() const {
+    return kHeaderSize + slots_ * slot_size_;
+}
+
+void AudioExchange::attach(void* base) {
+    char* bytes = static_cast<char*>(base);
+    base_ = bytes;
+    block_size_ = 0;
+    block_ = 0;
+    
+    std::memcpy(bytes + 4, &inputs_, 4);
+    std::memcpy(bytes + 8, &outputs_, 4);
+    std::memcpy(bytes + 12, &slots_, 4);
+    std::memcpy(bytes + 16, &max_block_, 4);
+    written_ = new (bytes + 64) std::atomic<uint32_t>(0);
+    for (uint32_t i = 0; i < slots_; i++) {
+        new (slot(i)) std::atomic<uint32_t>(0);
+    }
+    
+    // Magic last: the script checks it before trusting the rest
+    uint32_t magic = kMagic;
+    std::memcpy(bytes, &magic, 4);
+}
+
+void AudioExchange::detach() {
+    base_ = nullptr;
+    written_ = nullptr;
+    block_size_ = 0;
+}
+
+bool AudioExchange::configure(uint32_t block_size, float sample_rate) {
+    if (!base_ || block_size > max_block_) {
+        block_size_ = 0;
+        return false;
+    }
+    block_size_ = block_size;
+    std::memcpy(base_ + 20, &block_size, 4);
+    std::memcpy(base_ + 24, &sample_rate, 4);
+    return true;
+}
+
+char* AudioExchange::slot(uint32_t block) const {
+    return base_ + kHeaderSize + (block % slots_) * slot_size_;
+}
+
+float* AudioExchange::input(uint32_t channel) {
+    char* data = slot(block_) + kSlotHeaderSize;
+    return reinterpret_cast<float*>(data) + static_cast<size_t>(channel) * max_block_;
+}
+
+bool AudioExchange::collect() {
+    // Nothing is due until the first block has gone all the way round
+    uint32_t delay = slots_ - 1;
+    if (block_ < delay) {
+        return false;
+    }
+    playing_ = block_ - delay;
+    auto* tag = reinterpret_cast<std::atomic<uint32_t>*>(slot(playing_));
+    if (tag->load(std::memory_order_acquire) != playing_ + 1) {
+        underruns_++;
+        return false;
+    }
+    return true;
+}
+
+const float* AudioExchange::output(uint32_t channel) const {
+    const char* data = slot(playing_) + kSlotHeaderSize;
+    return reinterpret_cast<const float*>(data) + static_cast<size_t>(inputs_ + channel) * max_block_;
+}
+
+void AudioExchange::publish() {
+    // seq_cst, like a ring push: the doorbell check that follows must not
+    // be ordered before it (see ShmRing::take_waiting)
+    block_++;
+    written_->store(block_, std::memory_order_seq_cst);
+}
+
+} // namespace pdnode
@@ -0,0 +1,116 @@
+/**
+ * audio_exchange.h
+ * 
+ * Signal blocks shared with the script of a [node~]. wrapper.js
+ * implements the same layout (see AudioExchange there).
+ * 
+ * Layout (little endian, offsets in bytes from the region base):
+ *   0    u32 magic ('PDAU')
+ *   4    u32 inputs       (signal channels Pd -> JS)
+ *   8    u32 outputs      (signal channels JS -> Pd)
+ *   12   u32 slots        (blocks in flight)
+ *   16   u32 max_block    (samples per channel a slot has room for)
+ *   20   u32 block_size   (current, set when DSP starts)
+ *   24   f32 sample_rate
+ *   64   u32 written      (Pd: blocks published, free-running)
+ *   256  slot[slots]
+ * 
+ * Block n lives in slot n % slots: a u32 tag, padding up to 16 bytes,
+ * then max_block f32 per input channel and max_block f32 per output
+ * channel. The script processes published blocks in order and sets the
+ * tag to n + 1 once the outputs of block n are written. Pd plays them
+ * slots - 1 blocks later, so the script gets that long to answer and Pd
+ * never waits for it: a block that isn't done by then is played as
+ * silence.
+ */
+
+#ifndef PD_NODE_AUDIO_EXCHANGE_H
+#define PD_NODE_AUDIO_EXCHANGE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace pdnode {
+
+class AudioExchange {
+public:
+    static constexpr uint32_t kMagic = 0x55414450;  // 'PDAU'
+    static constexpr size_t kHeaderSize = 256;
+    static constexpr size_t kSlotHeaderSize = 16;
+    static constexpr uint32_t kMaxBlock = 4096;
+    
+    AudioExchange(uint32_t inputs, uint32_t outputs, uint32_t slots, uint32_t max_block = kMaxBlock);
+    
+    /**
+     * Bytes the region needs
+     */
+    size_t region_size() const;
+    
+    /**
+     * Lay out a fresh region at `base` (region_size() bytes, zero-filled)
+     */
+    void attach(void* base);
+    
+    /**
+     * Forget the region (before it is unmapped)
+     */
+    void detach();
+    
+    bool valid() const { return base_ != nullptr; }
+    uint32_t inputs() const { return inputs_; }
+    uint32_t outputs() const { return outputs_; }
+    
+    /**
+     * Set the block size and sample rate when DSP starts
+     * Returns false if the block does not fit a slot.
+     */
+    bool configure(uint32_t block_size, float sample_rate);
+    
+    uint32_t block_size() const { return block_size_; }
+    
+    /**
+     * Input buffer of the block about to be published (block_size() samples)
+     */
+    float* input(uint32_t channel);
+    
+    /**
+     * Check whether the block due for playback now is done. Call once per
+     * block; counts an underrun if it isn't.
+     */
+    bool collect();
+    
+    /**
+     * Output of the block collect() found done
+     */
+    const float* output(uint32_t channel) const;
+    
+    /**
+     * Hand the inputs to the script and move on to the next block
+     */
+    void publish();
+    
+    /**
+     * Blocks played as silence because the script was late
+     */
+    uint64_t underruns() const { return underruns_; }
+    
+private:
+    char* slot(uint32_t block) const;
+    
+    char* base_;
+    std::atomic<uint32_t>* written_;
+    uint32_t inputs_;
+    uint32_t outputs_;
+    uint32_t slots_;
+    uint32_t max_block_;
+    uint32_t block_size_;
+    size_t slot_size_;
+    uint32_t block_;     // Next block to publish
+    uint32_t playing_;   // Block collect() found done
+    uint64_t underruns_;
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_AUDIO_EXCHANGE_H
@@ -0,0 +1,127 @@
+/**
+ * frame.cpp
+ * 
+ * Length-prefixed binary framing shared with wrapper.js
+ */
+
+#include "frame.h"
+#include <cstring>
+
+namespace pdnode {
+
+static inline void put_u16(char* out, uint16_t v) {
+    out[0] = static_cast<char>(v & 0xFF);
+    out[1] = static_cast<char>(v >> 8);
+}
+
+static inline void put_u32(char* out, uint32_t v) {
+    out[0] = static_cast<char>(v & 0xFF);
+    out[1] = static_cast<char>((v >> 8) & 0xFF);
+    out[2] = static_cast<char>((v >> 16) & 0xFF);
+    out[3] = static_cast<char>(v >> 24);
+}
+
+static inline uint16_t get_u16(const char* in) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(in);
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32(const char* in) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(in);
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+        | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static inline void put_f64(char* out, double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, 8);
+    put_u32(out, static_cast<uint32_t>(bits));
+    put_u32(out + 4, static_cast<uint32_t>(bits >> 32));
+}
+
+static inline double get_f64(const char* in) {
+    uint64_t bits = get_u32(in) | (static_cast<uint64_t>(get_u32(in + 4)) << 32);
+    double v;
+    std::memcpy(&v, &bits, 8);
+    return v;
+}
+
+void encode_frame_header(char* out, const FrameHeader& header) {
+    put_u32(out, header.length);
+    out[4] = static_cast<char>(header.type);
+    out[5] = static_cast<char>(header.flags);
+    put_u16(out + 6, header.port);
+}
+
+FrameHeader decode_frame_header(const char* in) {
+    FrameHeader header;
+    header.length = get_u32(in);
+    header.type = static_cast<FrameType>(static_cast<unsigned char>(in[4]));
+    header.flags = static_cast<uint8_t>(in[5]);
+    header.port = get_u16(in + 6);
+    return header;
+}
+
+uint8_t frame_extension_flags(const FrameExtensions& ext) {
+    uint8_t flags = 0;
+    if (ext.channel != 0) {
+        flags |= kFrameFlagChannel;
+    }
+    if (ext.time != 0) {
+        flags |= kFrameFlagTime;
+    }
+    if (ext.seq != 0) {
+        flags |= kFrameFlagSeq;
+    }
+    return flags;
+}
+
+size_t encode_frame_extensions(char* out, const FrameExtensions& ext) {
+    size_t size = 0;
+    if (ext.channel != 0) {
+        put_u32(out + size, ext.channel);
+        size += 4;
+    }
+    if (ext.time != 0) {
+        put_f64(out + size, ext.time);
+        size += 8;
+    }
+    if (ext.seq != 0) {
+        put_u32(out + size, ext.seq);
+        size += 4;
+    }
+    return size;
+}
+
+bool decode_frame_extensions(FrameView& frame) {
+    frame.channel = 0;
+    if (frame.flags & kFrameFlagChannel) {
+        if (frame.size < 4) {
+            return false;
+        }
+        frame.channel = get_u32(frame.data);
+        frame.data += 4;
+        frame.size -= 4;
+    }
+    frame.time = 0;
+    if (frame.flags & kFrameFlagTime) {
+        if (frame.size < 8) {
+            return false;
+        }
+        frame.time = get_f64(frame.data);
+        frame.data += 8;
+        frame.size -= 8;
+    }
+    frame.seq = 0;
+    if (frame.flags & kFrameFlagSeq) {
+        if (frame.size < 4) {
+            return false;
+        }
+        frame.seq = get_u32(frame.data);
+        frame.data += 4;
+        frame.size -= 4;
+    }
+    return true;
+}
+
+} // namespace pdnode
@@ -0,0 +1,115 @@
+/**
+ * frame.h
+ * 
+ * Length-prefixed binary framing shared with wrapper.js
+ * 
+ * Header (8 bytes, little endian):
+ *   0  u32 length  (payload bytes, header excluded)
+ *   4  u8  type    (FrameType)
+ *   5  u8  flags   (extension fields present, see kFrameFlag*)
+ *   6  u16 port    (inlet for MESSAGE, outlet for OUTLET)
+ * followed by the extension fields announced in `flags` (in flag bit
+ * order) and the payload, `length` bytes in total. The payload may be
+ * arbitrary binary.
+ */
+
+#ifndef PD_NODE_FRAME_H
+#define PD_NODE_FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pdnode {
+
+/**
+ * Frame types (values are shared with wrapper.js)
+ */
+enum class FrameType : uint8_t {
+    JSON    = 0,   // Self-describing JSON message (newline framing)
+    READY   = 1,   // JS -> Pd: runtime booted, payload is JSON capabilities
+    MESSAGE = 2,   // Pd -> JS: message arriving on an inlet
+    OUTLET  = 3,   // JS -> Pd: message for an outlet
+    LOG     = 4,   // JS -> Pd: text for the Pd console
+    ERROR   = 5,   // JS -> Pd: error text for the Pd console
+    LOAD    = 6,   // Pd -> JS: load the script at this path (pooled process)
+    UNLOAD  = 7,   // Pd -> JS: forget the script on this channel (shared host)
+    ARRAY   = 8    // Pd -> JS: JSON {name, path, length} of a shared array
+                   // (no path: unshared); JS -> Pd: name of an array to write back
+};
+
+/**
+ * Header flags announcing extension fields
+ */
+constexpr uint8_t kFrameFlagChannel = 0x01;  // u32 channel: instance in a shared host
+constexpr uint8_t kFrameFlagTime = 0x02;     // f64 Pd logical time in ms: when a
+                                             // MESSAGE was sent, when an OUTLET is due
+constexpr uint8_t kFrameFlagSeq = 0x04;      // u32 sequence number of a MESSAGE, echoed
+                                             // by the OUTLETs sent while handling it
+
+/**
+ * Extension field values; a field is sent only if it is non-zero
+ */
+struct FrameExtensions {
+    uint32_t channel = 0;
+    double time = 0;
+    uint32_t seq = 0;
+};
+
+constexpr size_t kMaxFrameExtensionSize = 16;
+
+/**
+ * Decoded frame. The payload points into the receive buffer and is only
+ * valid while the frame is being handled. Extension fields are already
+ * split off the payload.
+ */
+struct FrameView {
+    FrameType type;
+    uint8_t flags;
+    uint16_t port;
+    const char* data;
+    size_t size;
+    uint32_t channel;
+    double time;
+    uint32_t seq;
+};
+
+struct FrameHeader {
+    uint32_t length;
+    FrameType type;
+    uint8_t flags;
+    uint16_t port;
+};
+
+constexpr size_t kFrameHeaderSize = 8;
+constexpr uint32_t kMaxFrameLength = 1u << 26;  // Sanity limit (64 MB)
+
+/**
+ * Write a header into `out` (kFrameHeaderSize bytes)
+ */
+void encode_frame_header(char* out, const FrameHeader& header);
+
+/**
+ * Read a header from `in` (kFrameHeaderSize bytes)
+ */
+FrameHeader decode_frame_header(const char* in);
+
+/**
+ * Header flags for the non-zero fields of `ext`
+ */
+uint8_t frame_extension_flags(const FrameExtensions& ext);
+
+/**
+ * Write the non-zero fields of `ext` into `out` (up to
+ * kMaxFrameExtensionSize bytes). Returns the number of bytes written.
+ */
+size_t encode_frame_extensions(char* out, const FrameExtensions& ext);
+
+/**
+ * Move the extension fields announced in frame.flags from the start of
+ * the payload into the frame. Returns false if the payload is too short.
+ */
+bool decode_frame_extensions(FrameView& frame);
+
+} // namespace pdnode
+
+#endif // PD_NODE_FRAME_H
@@ -0,0 +1,239 @@
+/**
+ * inbound.cpp
+ * 
+ * Messages from JavaScript, decoded from frames into plain atoms
+ */
+
+#include "inbound.h"
+#include "json.hpp"
+#include <chrono>
+#include <cstring>
+#include <string>
+
+namespace pdnode {
+
+using json = nlohmann::json;
+
+void InboundMessage::clear() {
+    kind = InboundKind::INVALID;
+    port = 0;
+    channel = 0;
+    time = 0;
+    seq = 0;
+    bytes = 0;
+    parse_ns = 0;
+    selector = { AtomTag::SEL_BANG, 0, 0, 0, 0 };
+    atoms.clear();
+    floats.clear();
+    argc = 0;
+    text.clear();
+    target = 0;
+}
+
+void InboundMessage::assign(const InboundMessage& other) {
+    kind = other.kind;
+    port = other.port;
+    channel = other.channel;
+    time = other.time;
+    seq = other.seq;
+    bytes = other.bytes;
+    parse_ns = other.parse_ns;
+    selector = other.selector;
+    atoms = other.atoms;
+    floats = other.floats;
+    argc = other.argc;
+    text = other.text;
+    target = other.target;
+}
+
+// Store a symbol name (NUL-terminated) and return where it starts
+static uint32_t add_symbol(InboundMessage& out, const char* str, size_t len) {
+    uint32_t offset = static_cast<uint32_t>(out.text.size());
+    out.text.append(str, len);
+    out.text.push_back('\0');
+    return offset;
+}
+
+static void add_float(InboundMessage& out, float f) {
+    out.atoms.push_back({ AtomTag::FLOAT, f, 0, 0, 0 });
+    out.argc++;
+}
+
+// Copy a FLOAT_ARRAY block as is: emit_outlet() expands it in one loop
+static void add_float_array(InboundMessage& out, const AtomEntry& entry) {
+    uint32_t offset = static_cast<uint32_t>(out.floats.size());
+    uint32_t count = static_cast<uint32_t>(entry.len);
+    out.floats.resize(offset + count);
+    std::memcpy(out.floats.data() + offset, entry.str, count * sizeof(float));
+    out.atoms.push_back({ AtomTag::FLOAT_ARRAY, 0, offset, 0, count });
+    out.argc += count;
+}
+
+// A symbol entry, keeping its text and/or interned id
+static InboundAtom symbol_atom(InboundMessage& out, const AtomEntry& entry) {
+    InboundAtom atom = { entry.tag, 0, 0, 0, 0 };
+    if (entry.tag != AtomTag::SYMBOL_REF) {
+        atom.offset = add_symbol(out, entry.str, entry.len);
+    }
+    if (entry.tag != AtomTag::SYMBOL) {
+        atom.id = entry.id;
+    }
+    return atom;
+}
+
+static bool is_symbol(AtomTag tag) {
+    return tag == AtomTag::SYMBOL || tag == AtomTag::SYMBOL_DEF || tag == AtomTag::SYMBOL_REF;
+}
+
+static bool invalid(InboundMessage& out, const std::string& reason) {
+    out.kind = InboundKind::INVALID;
+    out.text = reason;
+    return true;
+}
+
+// Atom-codec payload of an OUTLET frame
+static bool decode_atoms(const FrameView& frame, InboundMessage& out) {
+    AtomReader reader(frame.data, frame.size);
+    AtomEntry entry;
+    if (!reader.next(entry)) {
+        return invalid(out, "Malformed outlet message");
+    }
+    if (is_symbol(entry.tag)) {
+        out.selector = symbol_atom(out, entry);
+    } else if (entry.tag == AtomTag::FLOAT || entry.tag == AtomTag::FLOAT_ARRAY) {
+        return invalid(out, "Malformed outlet message");
+    } else {
+        out.selector.tag = entry.tag;
+    }
+    
+    while (reader.next(entry)) {
+        if (entry.tag == AtomTag::FLOAT) {
+            add_float(out, entry.f);
+        } else if (is_symbol(entry.tag)) {
+            out.atoms.push_back(symbol_atom(out, entry));
+            out.argc++;
+        } else if (entry.tag == AtomTag::FLOAT_ARRAY) {
+            add_float_array(out, entry);
+        }
+    }
+    if (!reader.ok()) {
+        return invalid(out, "Malformed outlet message");
+    }
+    out.kind = InboundKind::OUTLET;
+    return true;
+}
+
+// {"type": "outlet", "outlet": n, "selector": "...", "args": [...]}
+static void decode_json_outlet(const json& msg, InboundMessage& out) {
+    std::string selector = msg.value("selector", "");
+    if (selector == "bang") {
+        out.selector.tag = AtomTag::SEL_BANG;
+    } else if (selector == "float") {
+        out.selector.tag = AtomTag::SEL_FLOAT;
+    } else if (selector == "symbol") {
+        out.selector.tag = AtomTag::SEL_SYMBOL;
+    } else if (selector == "list" || selector == "anything") {
+        // pd.outlet(0, [...]) says "anything", like the binary codec's SEL_LIST
+        out.selector.tag = AtomTag::SEL_LIST;
+    } else {
+        out.selector.tag = AtomTag::SYMBOL;
+        out.selector.offset = add_symbol(out, selector.data(), selector.size());
+    }
+    
+    auto args = msg.find("args");
+    if (args != msg.end() && args->is_array()) {
+        for (const json& arg : *args) {
+            if (arg.is_number()) {
+                add_float(out, arg.get<float>());
+            } else if (arg.is_string()) {
+                const std::string& str = arg.get_ref<const std::string&>();
+                out.atoms.push_back({ AtomTag::SYMBOL, 0, add_symbol(out, str.data(), str.size()), 0, 0 });
+                out.argc++;
+            }
+        }
+    }
+    out.port = static_cast<uint16_t>(msg.value("outlet", 0));
+    out.time = msg.value("time", 0.0);
+    out.seq = msg.value("seq", 0u);
+    out.kind = InboundKind::OUTLET;
+}
+
+// Self-describing message from LINES framing (or the payload of a READY)
+static bool decode_json(const FrameView& frame, InboundMessage& out) {
+    json msg = json::parse(frame.data, frame.data + frame.size, nullptr, false);
+    if (msg.is_discarded() || !msg.is_object()) {
+        return invalid(out, "JSON parse error");
+    }
+    
+    std::string type = msg.value("type", "");
+    out.channel = msg.value("channel", frame.channel);
+    if (type == "ready" || frame.type == FrameType::READY) {
+        out.kind = InboundKind::READY;
+        out.text = msg.value("transport", "pipe");
+    } else if (type == "outlet") {
+        decode_json_outlet(msg, out);
+    } else if (type == "log") {
+        out.kind = InboundKind::LOG;
+        out.text = msg.value("message", "");
+    } else if (type == "error") {
+        out.kind = InboundKind::ERROR;
+        out.text = msg.value("message", "");
+    } else if (type == "array") {
+        out.kind = InboundKind::ARRAY;
+        out.text = msg.value("name", "");
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Decode by frame type
+static bool decode_frame(const FrameView& frame, InboundMessage& out) {
+    try {
+        switch (frame.type) {
+            case FrameType::JSON:
+            case FrameType::READY:
+                return decode_json(frame, out);
+            
+            case FrameType::OUTLET:
+                return decode_atoms(frame, out);
+            
+            case FrameType::LOG:
+                out.kind = InboundKind::LOG;
+                out.text.assign(frame.data, frame.size);
+                return true;
+            
+            case FrameType::ERROR:
+                out.kind = InboundKind::ERROR;
+                out.text.assign(frame.data, frame.size);
+                return true;
+            
+            case FrameType::ARRAY:
+                out.kind = InboundKind::ARRAY;
+                out.text.assign(frame.data, frame.size);
+                return true;
+            
+            default:
+                return invalid(out, "Unknown frame type " + std::to_string(static_cast<int>(frame.type)));
+        }
+    } catch (json::exception& e) {
+        return invalid(out, std::string("JSON parse error: ") + e.what());
+    }
+}
+
+bool decode_inbound(const FrameView& frame, InboundMessage& out) {
+    auto start = std::chrono::steady_clock::now();
+    out.clear();
+    out.port = frame.port;
+    out.channel = frame.channel;
+    out.time = frame.time;
+    out.seq = frame.seq;
+    out.bytes = static_cast<uint32_t>(frame.size);
+    
+    bool result = decode_frame(frame, out);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    out.parse_ns = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    return result;
+}
+
+} // namespace pdnode
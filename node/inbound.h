@@ -0,0 +1,93 @@
+/**
+ * inbound.h
+ * 
+ * Messages from JavaScript, decoded from frames into plain atoms
+ * 
+ * Decoding needs nothing from Pd, so it can run on the I/O thread; only
+ * gensym() and the outlet calls are left for Pd's main thread.
+ */
+
+#ifndef PD_NODE_INBOUND_H
+#define PD_NODE_INBOUND_H
+
+#include "atom_codec.h"
+#include "frame.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pdnode {
+
+enum class InboundKind : uint8_t {
+    OUTLET,   // Message for outlet `port`
+    READY,    // Runtime booted; `text` is the transport it attached
+    LOG,      // Text for the Pd console
+    ERROR,    // Error text for the Pd console
+    ARRAY,    // The script wrote the mirror of the array named `text`
+    INVALID,  // Undecodable frame; `text` says why
+    
+    // Reported by the I/O thread instead of being read on Pd's thread
+    STDERR,   // Raw text the process wrote to stderr
+    CLOSED,   // The process closed its stdout
+    EXITED    // The exit descriptor fired, reap() will succeed
+};
+
+/**
+ * An atom: FLOAT, or a symbol given as text (SYMBOL), as text to remember
+ * under `id` (SYMBOL_DEF) or by `id` alone (SYMBOL_REF). Symbol text lives
+ * in InboundMessage::text.
+ * 
+ * A FLOAT_ARRAY stays one entry: `count` floats starting at `offset` in
+ * InboundMessage::floats.
+ */
+struct InboundAtom {
+    AtomTag tag;
+    float f;
+    uint32_t offset;
+    uint16_t id;
+    uint32_t count;
+};
+
+/**
+ * One decoded message. Buffers are reused when a message is recycled.
+ */
+struct InboundMessage {
+    InboundKind kind = InboundKind::INVALID;
+    uint16_t port = 0;
+    uint32_t channel = 0;
+    double time = 0;  // OUTLET: Pd logical time (ms) it is due at, 0 = now
+    uint32_t seq = 0;        // OUTLET: inlet message it answers, 0 = none
+    uint32_t bytes = 0;      // Size of the frame it came in
+    uint32_t parse_ns = 0;   // Time decode_inbound() took
+    InboundAtom selector = { AtomTag::SEL_BANG, 0, 0, 0, 0 };  // SEL_* or a symbol
+    std::vector<InboundAtom> atoms;
+    std::vector<float> floats;  // FLOAT_ARRAY blocks, back to back
+    uint32_t argc = 0;          // Pd atoms `atoms` expands to
+    std::string text;  // Symbol names (each NUL-terminated) or console text
+    
+    uint64_t target = 0;                          // Set by the I/O thread
+    std::atomic<InboundMessage*> next{nullptr};   // MpscQueue link
+    
+    void clear();
+    
+    /**
+     * Copy everything but the queue link (to keep a message for later)
+     */
+    void assign(const InboundMessage& other);
+    
+    /**
+     * NUL-terminated symbol name, ready for gensym()
+     */
+    const char* symbol(uint32_t offset) const { return text.c_str() + offset; }
+};
+
+/**
+ * Decode `frame` (binary or a JSON line) into `out`
+ * Returns false for frames that carry nothing for Pd.
+ */
+bool decode_inbound(const FrameView& frame, InboundMessage& out);
+
+} // namespace pdnode
+
+#endif // PD_NODE_INBOUND_H
@@ -0,0 +1,154 @@
+/**
+ * instance_stats.cpp
+ * 
+ * Latency histograms and counters kept by every [node]
+ */
+
+#include "instance_stats.h"
+#include <algorithm>
+#include <chrono>
+
+namespace pdnode {
+
+static const int kSubBucketBits = 7;                        // 128 exact values
+static const uint64_t kSubBuckets = 1u << kSubBucketBits;
+static const uint64_t kHalfBuckets = kSubBuckets / 2;       // Per power of two above
+static const uint64_t kMaxValue = 0xFFFFFFFFull;
+static const size_t kBucketCount = (32 - kSubBucketBits + 1) * kHalfBuckets + kHalfBuckets;
+
+// Inlet messages awaiting a reply; older ones are forgotten
+static const size_t kPendingWindow = 1024;
+
+Histogram::Histogram()
+    : buckets_(kBucketCount, 0)
+    , count_(0)
+    , sum_(0)
+    , min_(0)
+    , max_(0)
+{
+}
+
+size_t Histogram::index_of(uint64_t value) {
+    if (value < kSubBuckets) {
+        return static_cast<size_t>(value);
+    }
+    // Keep the top kSubBucketBits bits: value >> shift is in [64, 128)
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - (kSubBucketBits - 1);
+    return static_cast<size_t>(shift * kHalfBuckets + (value >> shift));
+}
+
+uint64_t Histogram::upper_bound(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    uint64_t shift = index / kHalfBuckets - 1;
+    uint64_t sub = index - shift * kHalfBuckets;
+    return ((sub + 1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t value) {
+    if (value > kMaxValue) {
+        value = kMaxValue;
+    }
+    buckets_[index_of(value)]++;
+    if (count_ == 0 || value < min_) {
+        min_ = value;
+    }
+    if (value > max_) {
+        max_ = value;
+    }
+    count_++;
+    sum_ += value;
+}
+
+void Histogram::reset() {
+    std::fill(buckets_.begin(), buckets_.end(), 0);
+    count_ = 0;
+    sum_ = 0;
+    min_ = 0;
+    max_ = 0;
+}
+
+uint64_t Histogram::percentile(double fraction) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(fraction * count_ + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets_.size(); i++) {
+        seen += buckets_[i];
+        if (seen >= target) {
+            // The bucket bound may overshoot what was actually recorded
+            uint64_t bound = upper_bound(i);
+            return bound < max_ ? bound : max_;
+        }
+    }
+    return max_;
+}
+
+InstanceStats::InstanceStats()
+    : pending_(kPendingWindow, Pending{ 0, 0 })
+    , next_seq_(1)
+    , messages_out_(0)
+    , messages_in_(0)
+    , bytes_out_(0)
+    , bytes_in_(0)
+    , max_queue_depth_(0)
+{
+}
+
+uint64_t InstanceStats::now_us() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+uint32_t InstanceStats::sent() {
+    messages_out_++;
+    
+    uint32_t seq = next_seq_++;
+    if (next_seq_ == 0) {
+        next_seq_ = 1;  // 0 means "no sequence number"
+    }
+    pending_[seq % kPendingWindow] = { seq, now_us() };
+    return seq;
+}
+
+void InstanceStats::received(size_t bytes, uint32_t parse_ns, uint32_t seq) {
+    messages_in_++;
+    bytes_in_ += bytes;
+    parse_.record(parse_ns);
+    
+    if (seq == 0) {
+        return;
+    }
+    Pending& pending = pending_[seq % kPendingWindow];
+    if (pending.seq == seq) {
+        latency_.record(now_us() - pending.sent_us);
+        pending.seq = 0;
+    }
+}
+
+void InstanceStats::queue_depth(size_t depth) {
+    if (depth > max_queue_depth_) {
+        max_queue_depth_ = depth;
+    }
+}
+
+void InstanceStats::reset() {
+    latency_.reset();
+    parse_.reset();
+    for (Pending& pending : pending_) {
+        pending.seq = 0;
+    }
+    messages_out_ = 0;
+    messages_in_ = 0;
+    bytes_out_ = 0;
+    bytes_in_ = 0;
+    max_queue_depth_ = 0;
+}
+
+} // namespace pdnode
@@ -0,0 +1,122 @@
+/**
+ * instance_stats.h
+ * 
+ * Latency histograms and counters kept by every [node]
+ */
+
+#ifndef PD_NODE_INSTANCE_STATS_H
+#define PD_NODE_INSTANCE_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pdnode {
+
+/**
+ * Histogram - log-linear buckets in the style of HdrHistogram
+ * 
+ * Values below 128 are counted exactly; above that every power of two is
+ * split into 64 buckets, so a reported value is at most 1/64 (about 1.6%)
+ * above the true one. Values past 2^32 - 1 are counted as that maximum.
+ * Recording is a few integer operations and never allocates.
+ */
+class Histogram {
+public:
+    Histogram();
+    
+    void record(uint64_t value);
+    void reset();
+    
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0; }
+    
+    /**
+     * Smallest bucket bound that `fraction` (0..1) of the values are at or
+     * below (0 if nothing was recorded)
+     */
+    uint64_t percentile(double fraction) const;
+    
+private:
+    static size_t index_of(uint64_t value);
+    static uint64_t upper_bound(size_t index);
+    
+    std::vector<uint64_t> buckets_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+};
+
+/**
+ * Instance Stats - what one object sent, received and how fast
+ * 
+ * Inlet messages get a sequence number; an outlet message the script sends
+ * while handling one carries it back, which gives the round trip from the
+ * inlet to the outlet. Only the first reply to a message is timed. Not
+ * thread-safe: only used from Pd's main thread.
+ */
+class InstanceStats {
+public:
+    InstanceStats();
+    
+    /**
+     * Monotonic clock in microseconds
+     */
+    static uint64_t now_us();
+    
+    /**
+     * Count an inlet message and return the sequence number to send with
+     * it (never 0)
+     */
+    uint32_t sent();
+    
+    /**
+     * Count the payload bytes of an inlet message
+     */
+    void sent_bytes(size_t bytes) { bytes_out_ += bytes; }
+    
+    /**
+     * Count a message from the script (`bytes` of payload); times the
+     * round trip if `seq` answers a recent inlet message. `parse_ns` is
+     * its decoding time.
+     */
+    void received(size_t bytes, uint32_t parse_ns, uint32_t seq);
+    
+    /**
+     * Remember the deepest the outbound queue has been
+     */
+    void queue_depth(size_t depth);
+    
+    void reset();
+    
+    const Histogram& latency() const { return latency_; }   // Microseconds
+    const Histogram& parse_time() const { return parse_; }  // Nanoseconds
+    uint64_t messages_out() const { return messages_out_; }
+    uint64_t messages_in() const { return messages_in_; }
+    uint64_t bytes_out() const { return bytes_out_; }   // Payloads only
+    uint64_t bytes_in() const { return bytes_in_; }
+    size_t max_queue_depth() const { return max_queue_depth_; }
+    
+private:
+    struct Pending {
+        uint32_t seq;
+        uint64_t sent_us;
+    };
+    
+    Histogram latency_;
+    Histogram parse_;
+    std::vector<Pending> pending_;  // By seq, a window of recent messages
+    uint32_t next_seq_;
+    uint64_t messages_out_;
+    uint64_t messages_in_;
+    uint64_t bytes_out_;
+    uint64_t bytes_in_;
+    size_t max_queue_depth_;
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_INSTANCE_STATS_H
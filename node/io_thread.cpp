@@ -0,0 +1,277 @@
+/**
+ * io_thread.cpp
+ * 
+ * Optional background thread reading and decoding runtime output
+ */
+
+#include "io_thread.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace pdnode {
+
+static void make_wake_pipe(int fds[2]) {
+    if (pipe(fds) < 0) {
+        fds[0] = fds[1] = -1;
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+    }
+}
+
+static void drain_pipe(int fd) {
+    char buffer[64];
+    while (read(fd, buffer, sizeof(buffer)) > 0) {
+    }
+}
+
+IOThread& IOThread::instance() {
+    static IOThread thread;
+    return thread;
+}
+
+IOThread::IOThread()
+    : next_id_(1)
+    , stopping_(false)
+    , wake_pending_(false)
+    , posted_(false)
+{
+    make_wake_pipe(wake_pipe_);
+    make_wake_pipe(control_pipe_);
+}
+
+IOThread::~IOThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_thread();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    
+    while (InboundMessage* msg = inbox_.pop()) {
+        delete msg;
+    }
+    while (InboundMessage* msg = spare_.pop()) {
+        delete msg;
+    }
+    for (int fd : { wake_pipe_[0], wake_pipe_[1], control_pipe_[0], control_pipe_[1] }) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+uint64_t IOThread::watch(IPCBridge* bridge, const Sink& sink) {
+    uint64_t id = next_id_++;
+    sinks_[id] = sink;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        watches_.push_back({ id, bridge, bridge->stdout_fd() >= 0, bridge->stderr_fd() >= 0,
+                             bridge->exit_fd() >= 0 });
+        if (!thread_.joinable()) {
+            thread_ = std::thread(&IOThread::run, this);
+        }
+    }
+    wake_thread();
+    return id;
+}
+
+void IOThread::unwatch(uint64_t id) {
+    {
+        // Once we hold the lock the thread is not inside this bridge
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = watches_.begin(); it != watches_.end(); ++it) {
+            if (it->id == id) {
+                watches_.erase(it);
+                break;
+            }
+        }
+    }
+    wake_thread();
+    
+    // Messages still queued for it are dropped by drain()
+    sinks_.erase(id);
+}
+
+size_t IOThread::drain() {
+    // Clear the flag first: anything posted from now on wakes us again
+    drain_pipe(wake_pipe_[0]);
+    wake_pending_.store(false);
+    
+    size_t count = 0;
+    while (InboundMessage* msg = inbox_.pop()) {
+        auto it = sinks_.find(msg->target);
+        if (it != sinks_.end()) {
+            // A sink may unwatch itself
+            Sink sink = it->second;
+            sink(*msg);
+            count++;
+        }
+        spare_.push(msg);
+    }
+    return count;
+}
+
+void IOThread::wake_thread() {
+    const char byte = 0;
+    write(control_pipe_[1], &byte, 1);
+}
+
+InboundMessage* IOThread::take_message() {
+    InboundMessage* msg = spare_.pop();
+    return msg ? msg : new InboundMessage();
+}
+
+void IOThread::post(uint64_t id, InboundMessage* msg) {
+    msg->target = id;
+    inbox_.push(msg);
+    posted_ = true;
+}
+
+void IOThread::read_output(Watch& watch) {
+    IPCBridge& bridge = *watch.bridge;
+    InboundMessage* msg = take_message();
+    bridge.receive_messages([&](const FrameView& frame) {
+        if (!decode_inbound(frame, *msg)) {
+            return;
+        }
+        // Must happen before the next frame is read, so it can't wait for Pd
+        if (msg->kind == InboundKind::READY && msg->channel == 0) {
+            bridge.settle_transport(msg->text);
+        }
+        post(watch.id, msg);
+        msg = take_message();
+    });
+    
+    if (bridge.at_eof()) {
+        watch.stdout_open = false;
+        msg->clear();
+        msg->kind = InboundKind::CLOSED;
+        post(watch.id, msg);
+    } else {
+        spare_.push(msg);
+    }
+}
+
+void IOThread::read_stderr(Watch& watch) {
+    InboundMessage* msg = take_message();
+    msg->clear();
+    msg->kind = InboundKind::STDERR;
+    watch.stderr_open = watch.bridge->read_stderr(msg->text);
+    if (msg->text.empty()) {
+        spare_.push(msg);
+    } else {
+        post(watch.id, msg);
+    }
+}
+
+void IOThread::run() {
+    // Which watch and descriptor each pollfd belongs to
+    enum Source { STDOUT, STDERR, EXIT };
+    struct Owner {
+        uint64_t id;
+        Source source;
+    };
+    std::vector<struct pollfd> fds;
+    std::vector<Owner> owners;
+    
+    for (;;) {
+        fds.clear();
+        owners.clear();
+        fds.push_back({ control_pipe_[0], POLLIN, 0 });
+        owners.push_back({ 0, EXIT });
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+            for (const Watch& watch : watches_) {
+                if (watch.stdout_open) {
+                    fds.push_back({ watch.bridge->stdout_fd(), POLLIN, 0 });
+                    owners.push_back({ watch.id, STDOUT });
+                }
+                if (watch.stderr_open) {
+                    fds.push_back({ watch.bridge->stderr_fd(), POLLIN, 0 });
+                    owners.push_back({ watch.id, STDERR });
+                }
+                if (watch.exit_open) {
+                    fds.push_back({ watch.bridge->exit_fd(), POLLIN, 0 });
+                    owners.push_back({ watch.id, EXIT });
+                }
+            }
+        }
+        
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            continue;  // EINTR
+        }
+        if (fds[0].revents) {
+            drain_pipe(control_pipe_[0]);
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 1; i < fds.size(); i++) {
+                if (!fds[i].revents) {
+                    continue;
+                }
+                // The watch may have gone while we were polling
+                Watch* watch = nullptr;
+                for (Watch& candidate : watches_) {
+                    if (candidate.id == owners[i].id) {
+                        watch = &candidate;
+                        break;
+                    }
+                }
+                if (!watch) {
+                    continue;
+                }
+                
+                switch (owners[i].source) {
+                    case STDOUT:
+                        if (watch->stdout_open) {
+                            read_output(*watch);
+                        }
+                        break;
+                    case STDERR:
+                        if (watch->stderr_open) {
+                            read_stderr(*watch);
+                        }
+                        break;
+                    case EXIT:
+                        // Deliver its last output first
+                        if (watch->stdout_open) {
+                            read_output(*watch);
+                        }
+                        if (watch->stderr_open) {
+                            read_stderr(*watch);
+                        }
+                        if (watch->exit_open) {
+                            watch->exit_open = false;
+                            InboundMessage* msg = take_message();
+                            msg->clear();
+                            msg->kind = InboundKind::EXITED;
+                            post(watch->id, msg);
+                        }
+                        break;
+                }
+            }
+        }
+        
+        // One wakeup for everything read in this pass
+        if (posted_) {
+            posted_ = false;
+            if (!wake_pending_.exchange(true)) {
+                const char byte = 0;
+                write(wake_pipe_[1], &byte, 1);
+            }
+        }
+    }
+}
+
+} // namespace pdnode
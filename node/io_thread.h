@@ -0,0 +1,106 @@
+/**
+ * io_thread.h
+ * 
+ * Optional background thread reading and decoding runtime output
+ */
+
+#ifndef PD_NODE_IO_THREAD_H
+#define PD_NODE_IO_THREAD_H
+
+#include "inbound.h"
+#include "ipc_bridge.h"
+#include "mpsc_queue.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pdnode {
+
+/**
+ * I/O Thread - takes reading off Pd's scheduler thread
+ * 
+ * Watched bridges have their stdout, stderr and exit descriptors polled
+ * here. Frames are read and decoded into InboundMessages, which are queued
+ * without locks for Pd's main thread. wake_fd() becomes readable when
+ * messages are waiting; drain() then hands them to their sinks in one go.
+ * Writing stays on Pd's thread (it never blocks there).
+ */
+class IOThread {
+public:
+    /**
+     * Called on Pd's main thread for each message of a watched bridge
+     */
+    using Sink = std::function<void(InboundMessage&)>;
+    
+    /**
+     * Process-wide I/O thread; started on the first watch()
+     */
+    static IOThread& instance();
+    
+    /**
+     * Start reading `bridge` on the I/O thread. From now on only this
+     * thread may call its receive_messages()/read_stderr(). Returns an id
+     * for unwatch() (never 0).
+     */
+    uint64_t watch(IPCBridge* bridge, const Sink& sink);
+    
+    /**
+     * Stop reading the bridge (waits if the thread is busy with it) and
+     * discard its undelivered messages. The bridge may be deleted afterwards.
+     */
+    void unwatch(uint64_t id);
+    
+    /**
+     * Readable while messages are waiting (Pd's sys_addpollfn)
+     */
+    int wake_fd() const { return wake_pipe_[0]; }
+    
+    /**
+     * Deliver every waiting message. Pd's main thread only.
+     * Returns the number of messages delivered.
+     */
+    size_t drain();
+
+private:
+    IOThread();
+    ~IOThread();
+    IOThread(const IOThread&) = delete;
+    IOThread& operator=(const IOThread&) = delete;
+    
+    struct Watch {
+        uint64_t id;
+        IPCBridge* bridge;
+        bool stdout_open;
+        bool stderr_open;
+        bool exit_open;
+    };
+    
+    void run();
+    void read_output(Watch& watch);
+    void read_stderr(Watch& watch);
+    void post(uint64_t id, InboundMessage* msg);
+    InboundMessage* take_message();
+    void wake_thread();
+    
+    std::mutex mutex_;              // Guards watches_ and the watched bridges
+    std::vector<Watch> watches_;
+    std::map<uint64_t, Sink> sinks_;  // Pd's thread only
+    uint64_t next_id_;
+    bool stopping_;
+    std::thread thread_;
+    
+    MpscQueue<InboundMessage> inbox_;  // I/O thread -> Pd
+    MpscQueue<InboundMessage> spare_;  // Pd -> I/O thread, for reuse
+    std::atomic<bool> wake_pending_;
+    bool posted_;                      // Messages queued in this pass
+    int wake_pipe_[2];                 // Wakes Pd
+    int control_pipe_[2];              // Wakes us when watches change
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_IO_THREAD_H
@@ -6,20 +6,66 @@
  */
 
 #include "ipc_bridge.h"
+#include "process_reaper.h"
+#include "json.hpp"
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <iostream>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#ifdef __APPLE__
+#include <sys/event.h>
+#endif
+
+extern char **environ;
 
 namespace pdnode {
 
-IPCBridge::IPCBridge(const std::string& runtime_path, const std::string& wrapper_path, const std::string& script_path)
+// Write right away once this much is queued, without waiting for the tick
+static const size_t kOutputFlushThreshold = 64 * 1024;
+
+// Records handed to a single writev
+static const int kMaxIovecs = 256;
+
+// Longest the BLOCK policy stalls Pd for one message before dropping it
+static const int kBlockTimeoutMs = 100;
+
+// How often a full shared memory ring is checked for room
+static const int kRingRetryUs = 100;
+
+IPCBridge::IPCBridge(const std::string& runtime_path, const std::string& wrapper_path, const std::string& script_path,
+                     const BridgeOptions& options)
     : runtime_path_(runtime_path)
     , wrapper_path_(wrapper_path)
     , script_path_(script_path)
+    , options_(options)
     , child_pid_(-1)
+    , child_exited_(false)
+    , exit_code_(-1)
+    , exit_signal_(0)
+    , exit_fd_(-1)
+    , read_start_(0)
+    , read_end_(0)
+    , read_scan_(0)
+    , stdout_eof_(false)
+    , shm_active_(false)
+    , awaiting_transport_(false)
+    , out_offset_(0)
+    , out_bytes_(0)
+    , dropped_messages_(0)
+    , block_expired_(false)
 {
     stdin_pipe_[0] = stdin_pipe_[1] = -1;
     stdout_pipe_[0] = stdout_pipe_[1] = -1;
@@ -30,161 +76,792 @@ IPCBridge::~IPCBridge() {
     terminate();
 }
 
+// Create a pipe whose ends are not inherited by exec'd children
+static bool make_pipe(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    // No pipe2 (macOS): set the flag right after, we don't fork concurrently
+    if (pipe(fds) < 0) {
+        return false;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+
+// Move `fd` above the descriptors the child expects (0-2 and the shared
+// region), so the spawn's dup2 actions can't clobber one another
+static int raise_fd(int fd) {
+    if (fd > IPCBridge::kShmChildFd) {
+        return fd;
+    }
+    int raised = fcntl(fd, F_DUPFD_CLOEXEC, IPCBridge::kShmChildFd + 1);
+    close(fd);
+    return raised;
+}
+
+// Descriptor that becomes readable once `pid` exits, or -1
+static int open_exit_fd(pid_t pid) {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    int fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+    if (fd >= 0) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    return fd;
+#elif defined(__APPLE__)
+    // A kqueue is readable while it has a pending event
+    int fd = kqueue();
+    if (fd < 0) {
+        return -1;
+    }
+    struct kevent change;
+    EV_SET(&change, pid, EVFILT_PROC, EV_ADD | EV_ONESHOT, NOTE_EXIT, 0, nullptr);
+    if (kevent(fd, &change, 1, nullptr, 0, nullptr) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+static void close_pipe(int fds[2]) {
+    for (int i = 0; i < 2; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+            fds[i] = -1;
+        }
+    }
+}
+
 bool IPCBridge::spawn() {
     // Create pipes for stdin, stdout, stderr
-    if (pipe(stdin_pipe_) < 0) {
+    if (!make_pipe(stdin_pipe_)) {
         std::cerr << "[node] Failed to create stdin pipe" << std::endl;
         return false;
     }
-    if (pipe(stdout_pipe_) < 0) {
+    if (!make_pipe(stdout_pipe_)) {
         std::cerr << "[node] Failed to create stdout pipe" << std::endl;
-        close(stdin_pipe_[0]);
-        close(stdin_pipe_[1]);
+        close_pipe(stdin_pipe_);
         return false;
     }
-    if (pipe(stderr_pipe_) < 0) {
+    if (!make_pipe(stderr_pipe_)) {
         std::cerr << "[node] Failed to create stderr pipe" << std::endl;
-        close(stdin_pipe_[0]);
-        close(stdin_pipe_[1]);
-        close(stdout_pipe_[0]);
-        close(stdout_pipe_[1]);
+        close_pipe(stdin_pipe_);
+        close_pipe(stdout_pipe_);
         return false;
     }
+    stdin_pipe_[0] = raise_fd(stdin_pipe_[0]);
+    stdout_pipe_[1] = raise_fd(stdout_pipe_[1]);
+    stderr_pipe_[1] = raise_fd(stderr_pipe_[1]);
     
-    // Fork the process
-    child_pid_ = fork();
+    // Shared memory is optional: without it we just stay on the pipes
+    if (options_.transport == Transport::SHARED_MEMORY && !create_shared_memory()) {
+        std::cerr << "[node] Shared memory unavailable, using pipes" << std::endl;
+    }
     
-    if (child_pid_ < 0) {
-        // Fork failed
-        std::cerr << "[node] Fork failed" << std::endl;
-        return false;
+    // Build the child environment
+    std::vector<std::string> env_strings;
+    for (char** env = environ; *env; ++env) {
+        env_strings.push_back(*env);
+    }
+    if (options_.framing == Framing::BINARY) {
+        env_strings.push_back("PD_NODE_FRAMING=binary");
     }
+    if (shm_.valid()) {
+        env_strings.push_back("PD_NODE_SHM_FD=" + std::to_string(kShmChildFd));
+        if (options_.audio_bytes > 0) {
+            size_t offset = ShmRing::region_size(options_.ring_capacity) * 2;
+            env_strings.push_back("PD_NODE_AUDIO_OFFSET=" + std::to_string(offset));
+        }
+    }
+    if (script_path_.empty()) {
+        env_strings.push_back("PD_NODE_POOL=1");
+    }
+    std::vector<char*> child_env;
+    for (std::string& entry : env_strings) {
+        child_env.push_back(&entry[0]);
+    }
+    child_env.push_back(nullptr);
     
-    if (child_pid_ == 0) {
-        // Child process
-        
-        // Redirect stdin
-        close(stdin_pipe_[1]);  // Close write end
-        dup2(stdin_pipe_[0], STDIN_FILENO);
-        close(stdin_pipe_[0]);
-        
-        // Redirect stdout
-        close(stdout_pipe_[0]);  // Close read end
-        dup2(stdout_pipe_[1], STDOUT_FILENO);
-        close(stdout_pipe_[1]);
-        
-        // Redirect stderr
-        close(stderr_pipe_[0]);  // Close read end
-        dup2(stderr_pipe_[1], STDERR_FILENO);
-        close(stderr_pipe_[1]);
-        
-        // Execute the runtime with wrapper.js and user script
-        // Command: bun wrapper.js user_script.js
-        execl(runtime_path_.c_str(), 
-              runtime_path_.c_str(),
-              wrapper_path_.c_str(),
-              script_path_.c_str(),
-              nullptr);
-        
-        // If we get here, exec failed
-        std::cerr << "[node] exec failed: " << strerror(errno) << std::endl;
-        exit(1);
+    // Command: bun wrapper.js user_script.js (no script when pooled)
+    char* const child_argv[] = {
+        const_cast<char*>(runtime_path_.c_str()),
+        const_cast<char*>(wrapper_path_.c_str()),
+        script_path_.empty() ? nullptr : const_cast<char*>(script_path_.c_str()),
+        nullptr
+    };
+    
+    // The child gets exactly: the three pipe ends on 0-2 and the shared
+    // region on 3. Everything else is close-on-exec.
+    int shm_source = -1;
+    if (shm_.valid()) {
+        shm_source = fcntl(shm_.fd(), F_DUPFD_CLOEXEC, kShmChildFd + 1);
+    }
+    
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, stdin_pipe_[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, stdout_pipe_[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, stderr_pipe_[1], STDERR_FILENO);
+    if (shm_source >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, shm_source, kShmChildFd);
     }
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+    // Also drop descriptors other code in Pd opened without O_CLOEXEC
+    posix_spawn_file_actions_addclosefrom_np(&actions, kShmChildFd + 1);
+#endif
     
-    // Parent process
+    // Start from default signal handling, whatever Pd installed
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attr, &signals);
+    sigaddset(&signals, SIGPIPE);
+    sigaddset(&signals, SIGCHLD);
+    posix_spawnattr_setsigdefault(&attr, &signals);
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_CLOEXEC_DEFAULT
+    flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;  // macOS: only the dup2'd fds survive
+#endif
+    posix_spawnattr_setflags(&attr, flags);
+    
+    // No fork: the child never copies Pd's address space
+    pid_t pid;
+    int err = posix_spawn(&pid, runtime_path_.c_str(), &actions, &attr, child_argv, child_env.data());
+    
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (shm_source >= 0) {
+        close(shm_source);
+    }
     
-    // Close unused pipe ends
-    close(stdin_pipe_[0]);   // We don't read from stdin
-    close(stdout_pipe_[1]);  // We don't write to stdout
-    close(stderr_pipe_[1]);  // We don't write to stderr
+    // Close the child's pipe ends, we don't use them
+    close(stdin_pipe_[0]);
+    close(stdout_pipe_[1]);
+    close(stderr_pipe_[1]);
+    stdin_pipe_[0] = stdout_pipe_[1] = stderr_pipe_[1] = -1;
     
-    // Set stdout and stderr to non-blocking
+    if (err != 0) {
+        std::cerr << "[node] Failed to start " << runtime_path_ << ": " << strerror(err) << std::endl;
+        close_pipe(stdin_pipe_);
+        close_pipe(stdout_pipe_);
+        close_pipe(stderr_pipe_);
+        shm_.release();
+        return false;
+    }
+    child_pid_ = pid;
+    exit_fd_ = open_exit_fd(pid);
+    
+    // Set all our pipe ends to non-blocking: a stalled script must never
+    // block Pd's scheduler on a full stdin pipe
+    set_nonblocking(stdin_pipe_[1]);
     set_nonblocking(stdout_pipe_[0]);
     set_nonblocking(stderr_pipe_[0]);
     
+    // Until 'ready' we don't know whether the JS side attached the rings
+    awaiting_transport_ = shm_.valid();
+    
     return true;
 }
 
+void IPCBridge::load_script(const std::string& script_path, uint32_t channel) {
+    if (channel == 0) {
+        script_path_ = script_path;
+    }
+    if (options_.framing == Framing::BINARY) {
+        send_message(script_path, FrameType::LOAD, 0, 0, channel);
+    } else {
+        nlohmann::json msg = { {"type", "load"}, {"script", script_path} };
+        if (channel != 0) {
+            msg["channel"] = channel;
+        }
+        send_message(msg.dump());
+    }
+}
+
+void IPCBridge::unload_script(uint32_t channel) {
+    if (options_.framing == Framing::BINARY) {
+        send_message(std::string(), FrameType::UNLOAD, 0, 0, channel);
+    } else {
+        nlohmann::json msg = { {"type", "unload"}, {"channel", channel} };
+        send_message(msg.dump());
+    }
+}
+
+void IPCBridge::share_array(const std::string& name, const std::string& path, size_t length, uint32_t channel) {
+    nlohmann::json msg = { {"name", name}, {"length", length} };
+    if (!path.empty()) {
+        msg["path"] = path;
+    }
+    if (options_.framing == Framing::BINARY) {
+        send_message(msg.dump(), FrameType::ARRAY, 0, 0, channel);
+    } else {
+        msg["type"] = "array";
+        if (channel != 0) {
+            msg["channel"] = channel;
+        }
+        send_message(msg.dump());
+    }
+}
+
+void IPCBridge::set_queue_policy(OverflowPolicy overflow, size_t queue_limit) {
+    options_.overflow = overflow;
+    options_.queue_limit = queue_limit;
+}
+
 bool IPCBridge::is_running() const {
+    return child_pid_ > 0 && !reap();
+}
+
+bool IPCBridge::reap() const {
     if (child_pid_ <= 0) {
         return false;
     }
+    if (child_exited_) {
+        return true;
+    }
     
-    // Check if process is still alive
     int status;
     pid_t result = waitpid(child_pid_, &status, WNOHANG);
-    
     if (result == 0) {
-        // Process is still running
-        return true;
-    } else {
-        // Process has exited
         return false;
     }
+    
+    // Its pid may be reused now, never signal it again
+    child_exited_ = true;
+    if (result == child_pid_) {
+        if (WIFEXITED(status)) {
+            exit_code_ = WEXITSTATUS(status);
+        } else if (WIFSIGNALED(status)) {
+            exit_signal_ = WTERMSIG(status);
+        }
+    }
+    return true;
 }
 
-void IPCBridge::send_message(const std::string& json_message) {
+void IPCBridge::send_message(const std::string& payload, FrameType type, uint16_t port,
+                             uintptr_t coalesce_key, uint32_t channel, double time, uint32_t seq) {
     if (stdin_pipe_[1] < 0) {
         return;
     }
     
-    // Send message with newline delimiter
-    std::string msg = json_message + "\n";
-    write(stdin_pipe_[1], msg.c_str(), msg.length());
+    // Encode into a recycled buffer so steady state does not allocate
+    std::string record;
+    if (!out_spare_.empty()) {
+        record.swap(out_spare_.back());
+        out_spare_.pop_back();
+    }
+    FrameExtensions ext;
+    ext.channel = channel;
+    ext.time = time;
+    ext.seq = seq;
+    encode_frame(record, payload, type, port, ext);
+    
+    if (out_queue_.size() >= options_.queue_limit && !make_queue_room(coalesce_key, port, channel, record)) {
+        return;  // Dropped or coalesced into a queued message
+    }
+    
+    out_bytes_ += record.size();
+    out_queue_.push_back({ std::move(record), coalesce_key, port, channel });
+    
+    if (out_bytes_ >= kOutputFlushThreshold) {
+        flush_output();
+    }
 }
 
-bool IPCBridge::try_receive_message(std::string& out_message) {
-    if (stdout_pipe_[0] < 0) {
+bool IPCBridge::make_queue_room(uintptr_t key, uint16_t port, uint32_t channel, std::string& record) {
+    // Writing may already have freed some room
+    flush_output();
+    if (out_queue_.size() < options_.queue_limit) {
+        block_expired_ = false;
+        return true;
+    }
+    
+    // The front record may be half written, it can't be dropped or changed
+    size_t first = (out_offset_ > 0) ? 1 : 0;
+    
+    switch (options_.overflow) {
+        case OverflowPolicy::BLOCK: {
+            // Before 'ready' nothing can drain, so just let the queue grow
+            if (awaiting_transport_) {
+                return true;
+            }
+            // A script that stopped reading must not hang Pd: wait a
+            // bounded time, then drop like DROP_NEWEST until there is room
+            // again without waiting any more
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kBlockTimeoutMs);
+            while (out_queue_.size() >= options_.queue_limit && stdin_pipe_[1] >= 0) {
+                if (block_expired_ || !wait_writable(deadline)) {
+                    block_expired_ = true;
+                    recycle(record);
+                    dropped_messages_++;
+                    return false;
+                }
+                flush_output();
+            }
+            return true;
+        }
+            
+        case OverflowPolicy::COALESCE_LATEST:
+            if (key != 0) {
+                for (size_t i = out_queue_.size(); i-- > first; ) {
+                    OutRecord& queued = out_queue_[i];
+                    if (queued.key == key && queued.port == port && queued.channel == channel) {
+                        out_bytes_ += record.size();
+                        out_bytes_ -= queued.bytes.size();
+                        queued.bytes.swap(record);
+                        recycle(record);
+                        dropped_messages_++;
+                        return false;
+                    }
+                }
+            }
+            // Nothing to coalesce with: make room like DROP_OLDEST
+            [[fallthrough]];
+            
+        case OverflowPolicy::DROP_OLDEST:
+            if (out_queue_.size() > first) {
+                OutRecord& oldest = out_queue_[first];
+                out_bytes_ -= oldest.bytes.size();
+                recycle(oldest.bytes);
+                out_queue_.erase(out_queue_.begin() + first);
+                dropped_messages_++;
+                return true;
+            }
+            // Only a half-written record is queued
+            [[fallthrough]];
+            
+        case OverflowPolicy::DROP_NEWEST:
+            recycle(record);
+            dropped_messages_++;
+            return false;
+    }
+    return true;
+}
+
+bool IPCBridge::wait_writable(std::chrono::steady_clock::time_point deadline) {
+    auto left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+    if (left.count() <= 0) {
         return false;
     }
+    if (shm_active_) {
+        // Nothing signals ring space: check again shortly
+        usleep(static_cast<useconds_t>(std::min<int64_t>(left.count(), kRingRetryUs)));
+        return true;
+    }
+    struct pollfd pfd = { stdin_pipe_[1], POLLOUT, 0 };
+    int timeout_ms = static_cast<int>((left.count() + 999) / 1000);
+    int ready = poll(&pfd, 1, timeout_ms);
+    return ready != 0 || std::chrono::steady_clock::now() < deadline;
+}
+
+bool IPCBridge::flush_output() {
+    if (out_queue_.empty()) {
+        return true;
+    }
+    if (stdin_pipe_[1] < 0) {
+        while (!out_queue_.empty()) {
+            recycle_front();
+        }
+        return true;
+    }
+    if (awaiting_transport_) {
+        return true;  // Written once 'ready' arrives
+    }
+    return shm_active_ ? flush_shared() : flush_pipe();
+}
+
+bool IPCBridge::flush_pipe() {
+    while (!out_queue_.empty()) {
+        // Gather as many queued records as fit into one writev
+        struct iovec iov[kMaxIovecs];
+        int count = 0;
+        for (auto it = out_queue_.begin(); it != out_queue_.end() && count < kMaxIovecs; ++it, ++count) {
+            size_t skip = (count == 0) ? out_offset_ : 0;
+            iov[count].iov_base = const_cast<char*>(it->bytes.data() + skip);
+            iov[count].iov_len = it->bytes.size() - skip;
+        }
+        
+        ssize_t written = writev(stdin_pipe_[1], iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                return false;
+            }
+            // The child is gone, nobody will read this
+            while (!out_queue_.empty()) {
+                recycle_front();
+            }
+            return true;
+        }
+        
+        // Short writes leave us in the middle of a record
+        size_t remaining = static_cast<size_t>(written);
+        while (remaining > 0) {
+            size_t left = out_queue_.front().bytes.size() - out_offset_;
+            if (remaining < left) {
+                out_offset_ += remaining;
+                break;
+            }
+            remaining -= left;
+            recycle_front();
+        }
+    }
+    return true;
+}
+
+void IPCBridge::recycle_front() {
+    std::string& record = out_queue_.front().bytes;
+    out_bytes_ -= record.size();
+    out_offset_ = 0;
+    recycle(record);
+    out_queue_.pop_front();
+}
+
+void IPCBridge::recycle(std::string& bytes) {
+    bytes.clear();
+    out_spare_.push_back(std::move(bytes));
+}
+
+size_t IPCBridge::receive_messages(const std::function<void(const FrameView&)>& handler) {
+    if (stdout_pipe_[0] < 0) {
+        return 0;
+    }
     
-    // Read available data (non-blocking)
-    char buffer[4096];
-    ssize_t n = read(stdout_pipe_[0], buffer, sizeof(buffer) - 1);
+    size_t count = 0;
+    if (!shm_active_) {
+        count += receive_pipe(handler);
+    }
+    // The 'ready' message may have switched us over to the rings
+    if (shm_active_) {
+        count += receive_shared(handler);
+    }
+    return count;
+}
+
+size_t IPCBridge::receive_pipe(const std::function<void(const FrameView&)>& handler) {
+    size_t count = 0;
     
-    if (n <= 0) {
-        return false;  // No data available or error
+    // Read until the pipe is empty, handing out complete messages as we go
+    while (!shm_active_) {
+        make_read_room();
+        ssize_t n = read(stdout_pipe_[0], read_buffer_.data() + read_end_, read_buffer_.size() - read_end_);
+        
+        if (n <= 0) {
+            if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                stdout_eof_ = true;
+            }
+            break;  // No data available or error
+        }
+        
+        read_end_ += static_cast<size_t>(n);
+        count += parse_buffered(handler);
+    }
+    return count;
+}
+
+size_t IPCBridge::parse_buffered(const std::function<void(const FrameView&)>& handler) {
+    size_t count = 0;
+    
+    while (read_start_ < read_end_) {
+        FrameView frame;
+        const char* base = read_buffer_.data();
+        
+        if (options_.framing == Framing::LINES) {
+            // Check if we have a complete line (delimited by \n)
+            size_t scan = read_scan_ > read_start_ ? read_scan_ : read_start_;
+            const void* newline = memchr(base + scan, '\n', read_end_ - scan);
+            if (!newline) {
+                read_scan_ = read_end_;  // Don't rescan this part next time
+                break;
+            }
+            size_t line_end = static_cast<const char*>(newline) - base;
+            frame = { FrameType::JSON, 0, 0, base + read_start_, line_end - read_start_, 0, 0, 0 };
+            read_start_ = line_end + 1;
+        } else {
+            // The header tells us exactly where the frame ends
+            if (read_end_ - read_start_ < kFrameHeaderSize) {
+                break;
+            }
+            FrameHeader header = decode_frame_header(base + read_start_);
+            if (header.length > kMaxFrameLength) {
+                std::cerr << "[node] Invalid frame length, dropping buffered input" << std::endl;
+                read_start_ = read_end_;
+                break;
+            }
+            size_t frame_size = kFrameHeaderSize + header.length;
+            if (read_end_ - read_start_ < frame_size) {
+                break;  // Incomplete frame
+            }
+            frame = { header.type, header.flags, header.port, base + read_start_ + kFrameHeaderSize, header.length, 0, 0, 0 };
+            read_start_ += frame_size;
+            if (!decode_frame_extensions(frame)) {
+                std::cerr << "[node] Truncated frame extensions, dropping frame" << std::endl;
+                continue;
+            }
+        }
+        
+        handler(frame);
+        count++;
+        
+        // Anything after 'ready' in shared memory mode is a doorbell
+        if (shm_active_) {
+            read_start_ = read_end_;
+        }
+    }
+    
+    if (read_start_ == read_end_) {
+        read_start_ = read_end_ = read_scan_ = 0;
+    }
+    return count;
+}
+
+void IPCBridge::make_read_room() {
+    const size_t chunk = 4096;
+    if (read_buffer_.size() - read_end_ >= chunk) {
+        return;
+    }
+    
+    // Move the partial message to the front, grow only if that is not enough
+    if (read_start_ > 0) {
+        memmove(read_buffer_.data(), read_buffer_.data() + read_start_, read_end_ - read_start_);
+        read_end_ -= read_start_;
+        read_scan_ = read_scan_ > read_start_ ? read_scan_ - read_start_ : 0;
+        read_start_ = 0;
+    }
+    if (read_buffer_.size() - read_end_ < chunk) {
+        read_buffer_.resize(read_buffer_.size() < 16 * chunk ? 16 * chunk : read_buffer_.size() * 2);
+    }
+}
+
+void IPCBridge::encode_frame(std::string& out, const std::string& payload, FrameType type, uint16_t port,
+                             const FrameExtensions& ext) const {
+    out.clear();
+    
+    // With LINES framing the extensions are fields of the JSON message
+    if (options_.framing == Framing::BINARY) {
+        char header[kFrameHeaderSize + kMaxFrameExtensionSize];
+        size_t ext_size = encode_frame_extensions(header + kFrameHeaderSize, ext);
+        encode_frame_header(header, { static_cast<uint32_t>(ext_size + payload.size()), type,
+                                      frame_extension_flags(ext), port });
+        out.append(header, kFrameHeaderSize + ext_size);
+    }
+    out += payload;
+    
+    // Ring records are delimited by the ring itself
+    if (options_.framing == Framing::LINES && !shm_active_) {
+        out += "\n";
+    }
+}
+
+bool IPCBridge::decode_record(const char* data, size_t size, FrameView& out_frame) const {
+    // Ring records hold exactly one encoded frame
+    if (options_.framing == Framing::LINES) {
+        out_frame = { FrameType::JSON, 0, 0, data, size, 0, 0, 0 };
+        return true;
+    }
+    
+    if (size < kFrameHeaderSize) {
+        return false;
+    }
+    FrameHeader header = decode_frame_header(data);
+    if (size != kFrameHeaderSize + header.length) {
+        return false;
+    }
+    out_frame = { header.type, header.flags, header.port, data + kFrameHeaderSize, header.length, 0, 0, 0 };
+    return decode_frame_extensions(out_frame);
+}
+
+size_t IPCBridge::receive_shared(const std::function<void(const FrameView&)>& handler) {
+    
+    size_t count = 0;
+    for (;;) {
+        // Records are handled in place, then released
+        const char* data;
+        size_t size;
+        while (from_js_.front(&data, &size)) {
+            FrameView frame;
+            if (decode_record(data, size, frame)) {
+                handler(frame);
+                count++;
+            }
+            from_js_.pop_front();
+        }
+        if (from_js_.corrupt()) {
+            std::cerr << "[node] Bad record in shared memory ring, using pipes" << std::endl;
+            use_pipe_transport();
+            return count;
+        }
+        
+        // Ring is empty: consume doorbells, ask for a new one and re-check
+        // so a record pushed in between is not missed
+        if (!drain_doorbells()) {
+            return count;
+        }
+        from_js_.set_waiting(true);
+        if (from_js_.empty()) {
+            return count;
+        }
+        from_js_.set_waiting(false);
+    }
+}
+
+bool IPCBridge::drain_doorbells() {
+    char buffer[256];
+    for (;;) {
+        ssize_t n = read(stdout_pipe_[0], buffer, sizeof(buffer));
+        if (n > 0) {
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            stdout_eof_ = true;
+            return false;
+        }
+        return true;
+    }
+}
+
+void IPCBridge::close_stdout() {
+    if (stdout_pipe_[0] >= 0) {
+        close(stdout_pipe_[0]);
+        stdout_pipe_[0] = -1;
+    }
+}
+
+bool IPCBridge::read_stderr(std::string& out) {
+    if (stderr_pipe_[0] < 0) {
+        return false;
     }
     
-    // Add to read buffer
-    buffer[n] = '\0';
-    read_buffer_ += buffer;
+    char buffer[4096];
+    for (;;) {
+        ssize_t n = read(stderr_pipe_[0], buffer, sizeof(buffer));
+        if (n > 0) {
+            out.append(buffer, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return true;
+        }
+        close(stderr_pipe_[0]);
+        stderr_pipe_[0] = -1;
+        return false;
+    }
+}
+
+bool IPCBridge::create_shared_memory() {
+    uint32_t capacity = options_.ring_capacity;
+    size_t ring_size = ShmRing::region_size(capacity);
     
-    // Check if we have a complete line (delimited by \n)
-    size_t newline_pos = read_buffer_.find('\n');
-    if (newline_pos == std::string::npos) {
-        return false;  // No complete line yet
+    if (!shm_.create(ring_size * 2 + options_.audio_bytes, "pd-node")) {
+        return false;
     }
     
-    // Extract the line
-    out_message = read_buffer_.substr(0, newline_pos);
-    read_buffer_ = read_buffer_.substr(newline_pos + 1);
+    // Pd -> JS ring first, JS -> Pd ring right after it, then any audio
+    char* base = static_cast<char*>(shm_.data());
+    to_js_.init(base, capacity);
+    from_js_.init(base + ring_size, capacity);
+    return true;
+}
+
+bool IPCBridge::enable_shared_memory() {
+    if (!shm_.valid()) {
+        return false;
+    }
     
+    // Anything left on stdout after 'ready' is a doorbell, not a message
+    read_start_ = read_end_ = read_scan_ = 0;
+    shm_active_ = true;
+    awaiting_transport_ = false;
     return true;
 }
 
+void IPCBridge::use_pipe_transport() {
+    shm_active_ = false;
+    awaiting_transport_ = false;
+}
+
+void IPCBridge::settle_transport(const std::string& transport) {
+    if (!(transport == "shm" && enable_shared_memory())) {
+        use_pipe_transport();
+    }
+}
+
+bool IPCBridge::flush_shared() {
+    bool pushed = false;
+    while (!out_queue_.empty()) {
+        const std::string& record = out_queue_.front().bytes;
+        if (record.size() > to_js_.max_payload()) {
+            std::cerr << "[node] Message too large for shared memory ring" << std::endl;
+            recycle_front();
+            continue;
+        }
+        if (!to_js_.push(record.data(), record.size())) {
+            break;  // Ring full, retry later
+        }
+        recycle_front();
+        pushed = true;
+    }
+    
+    // One doorbell for the whole batch
+    if (pushed && to_js_.take_waiting()) {
+        ring_doorbell();
+    }
+    return out_queue_.empty();
+}
+
+void* IPCBridge::audio_region() const {
+    if (!shm_.valid() || options_.audio_bytes == 0) {
+        return nullptr;
+    }
+    return static_cast<char*>(shm_.data()) + ShmRing::region_size(options_.ring_capacity) * 2;
+}
+
+void IPCBridge::wake_script() {
+    if (shm_active_ && to_js_.take_waiting()) {
+        ring_doorbell();
+    }
+}
+
+void IPCBridge::ring_doorbell() {
+    // Wakes the JS side; the byte itself carries no data
+    const char bell = '\n';
+    write(stdin_pipe_[1], &bell, 1);
+}
+
 void IPCBridge::on_message(std::function<void(const std::string&)> callback) {
     message_callback_ = callback;
 }
 
 void IPCBridge::terminate() {
+    // Never wait here: the reaper signals, waits and escalates in the background
     if (child_pid_ > 0) {
-        // Send SIGTERM
-        kill(child_pid_, SIGTERM);
-        
-        // Wait briefly for graceful shutdown
-        usleep(100000);  // 100ms
-        
-        // Check if still running
-        if (is_running()) {
-            // Force kill
-            kill(child_pid_, SIGKILL);
+        if (!child_exited_) {
+            ProcessReaper::instance().terminate(child_pid_);
         }
-        
-        // Wait for process to clean up
-        waitpid(child_pid_, nullptr, 0);
-        
         child_pid_ = -1;
+        child_exited_ = false;
+        exit_code_ = -1;
+        exit_signal_ = 0;
+    }
+    if (exit_fd_ >= 0) {
+        close(exit_fd_);
+        exit_fd_ = -1;
+    }
+    
+    // Release shared memory
+    shm_active_ = false;
+    awaiting_transport_ = false;
+    shm_.release();
+    while (!out_queue_.empty()) {
+        recycle_front();
     }
     
     // Close pipes
@@ -8,41 +8,185 @@
 #ifndef PD_NODE_IPC_BRIDGE_H
 #define PD_NODE_IPC_BRIDGE_H
 
+#include "frame.h"
+#include "shared_memory.h"
+#include "shm_ring.h"
+#include <atomic>
+#include <chrono>
 #include <string>
+#include <deque>
 #include <functional>
+#include <vector>
 #include <unistd.h>
 
 namespace pdnode {
 
+/**
+ * How messages travel between Pd and the JS process
+ */
+enum class Transport {
+    PIPE,           // Newline-delimited messages over stdin/stdout
+    SHARED_MEMORY   // SPSC rings in a shared mapping, pipes only as doorbells
+};
+
+/**
+ * How messages are delimited on the wire (negotiated at spawn time)
+ */
+enum class Framing {
+    LINES,   // Newline-delimited JSON (debug/fallback)
+    BINARY   // Length-prefixed frames, see frame.h
+};
+
+/**
+ * What to do when the outbound queue is full (the script is not reading)
+ */
+enum class OverflowPolicy {
+    BLOCK,            // Wait for the script to catch up (stalls Pd for up to
+                      // 100 ms, then drops like DROP_NEWEST until it reads)
+    DROP_OLDEST,      // Discard the oldest queued message
+    DROP_NEWEST,      // Discard the message being sent
+    COALESCE_LATEST   // Replace a queued message with the same selector/inlet
+};
+
+/**
+ * Per-bridge configuration chosen at object creation
+ */
+struct BridgeOptions {
+    Framing framing = Framing::BINARY;
+    Transport transport = Transport::PIPE;
+    uint32_t ring_capacity = 1u << 18;  // Bytes per direction (power of two)
+    OverflowPolicy overflow = OverflowPolicy::DROP_OLDEST;
+    size_t queue_limit = 4096;          // Messages queued before overflow
+    size_t audio_bytes = 0;             // Extra shared region for [node~] signal blocks
+};
+
 /**
  * IPC Bridge - Spawns and communicates with Bun/Node.js process
  */
 class IPCBridge {
 public:
-    IPCBridge(const std::string& runtime_path, const std::string& wrapper_path, const std::string& script_path);
+    IPCBridge(const std::string& runtime_path, const std::string& wrapper_path, const std::string& script_path,
+              const BridgeOptions& options = BridgeOptions());
     ~IPCBridge();
     
     /**
      * Spawn the Bun/Node.js process
+     * With an empty script path the runtime boots and waits for load_script()
      * Returns true if successful
      */
     bool spawn();
     
+    /**
+     * Tell a process spawned without a script to load one
+     * (on `channel` for a shared host, which may load many)
+     */
+    void load_script(const std::string& script_path, uint32_t channel = 0);
+    
+    /**
+     * Tell a shared host to drop the script on `channel`
+     */
+    void unload_script(uint32_t channel);
+    
+    /**
+     * Tell the script that the Pd array `name` is mirrored in the file at
+     * `path` (`length` floats), or that it is no longer (empty path)
+     */
+    void share_array(const std::string& name, const std::string& path, size_t length, uint32_t channel = 0);
+    
+    /**
+     * Change the queue settings of an already spawned bridge
+     */
+    void set_queue_policy(OverflowPolicy overflow, size_t queue_limit);
+    
     /**
      * Check if process is running
      */
     bool is_running() const;
     
     /**
-     * Send a message to the JavaScript process (via stdin)
+     * Reap the child if it has exited, without blocking. Returns true once
+     * it has; exit_code()/exit_signal() then say how it ended.
+     */
+    bool reap() const;
+    
+    /**
+     * Exit code of a reaped child, or -1 (killed by a signal, still running)
      */
-    void send_message(const std::string& json_message);
+    int exit_code() const { return exit_code_; }
+    
+    /**
+     * Signal that killed a reaped child, or 0
+     */
+    int exit_signal() const { return exit_signal_; }
+    
+    /**
+     * Queue a message for the JavaScript process. Nothing is written
+     * until flush_output(), so a whole scheduler tick goes out at once.
+     * With LINES framing the payload must be a self-describing JSON
+     * message and `type`/`port` are ignored.
+     * Messages with the same non-zero `coalesce_key`, port and channel may
+     * replace each other under OverflowPolicy::COALESCE_LATEST.
+     * A non-zero `channel` addresses one script in a shared host, a
+     * non-zero `time` stamps the message with Pd's logical time and a
+     * non-zero `seq` numbers it for latency statistics; with LINES framing
+     * the caller puts them into the JSON message instead.
+     */
+    void send_message(const std::string& payload, FrameType type = FrameType::JSON, uint16_t port = 0,
+                      uintptr_t coalesce_key = 0, uint32_t channel = 0, double time = 0, uint32_t seq = 0);
+    
+    /**
+     * Write queued messages (one writev, or ring pushes plus a single
+     * doorbell). Returns true when nothing is left pending.
+     */
+    bool flush_output();
+    
+    bool has_pending_output() const { return !out_queue_.empty(); }
+    size_t pending_output() const { return out_queue_.size(); }
     
     /**
-     * Try to read a message from JavaScript (via stdout)
-     * Non-blocking. Returns true if message was read.
+     * Messages discarded because the outbound queue was full
      */
-    bool try_receive_message(std::string& out_message);
+    uint64_t dropped_messages() const { return dropped_messages_; }
+    
+    /**
+     * Read everything JavaScript has written (via stdout or the ring) and
+     * call `handler` once per complete message, in order. Non-blocking.
+     * With LINES framing every frame has type FrameType::JSON.
+     * Returns the number of messages handled.
+     */
+    size_t receive_messages(const std::function<void(const FrameView&)>& handler);
+    
+    const BridgeOptions& options() const { return options_; }
+    
+    /**
+     * Descriptors to watch for readability (Pd's sys_addpollfn)
+     */
+    int stdout_fd() const { return stdout_pipe_[0]; }
+    int stderr_fd() const { return stderr_pipe_[0]; }
+    
+    /**
+     * Descriptor that becomes readable when the child exits (a pidfd on
+     * Linux, a kqueue on macOS), or -1 if the platform has none. Call
+     * reap() when it fires.
+     */
+    int exit_fd() const { return exit_fd_; }
+    
+    /**
+     * True once the child closed its stdout (it exited or crashed)
+     */
+    bool at_eof() const { return stdout_eof_; }
+    
+    /**
+     * Stop reading stdout after EOF (stdout_fd() becomes -1), while the
+     * process itself may still be exiting
+     */
+    void close_stdout();
+    
+    /**
+     * Append whatever the child wrote to stderr. Non-blocking.
+     * Returns false once stderr has been closed.
+     */
+    bool read_stderr(std::string& out);
     
     /**
      * Set callback for when we receive stdout from JS
@@ -50,16 +194,59 @@ public:
     void on_message(std::function<void(const std::string&)> callback);
     
     /**
-     * Terminate the child process
+     * Switch to the shared memory rings once the JS side has attached
+     * (reported in its 'ready' message). Returns false if unavailable.
+     */
+    bool enable_shared_memory();
+    
+    /**
+     * The JS side could not attach the rings: stay on the pipes
+     */
+    void use_pipe_transport();
+    
+    /**
+     * Apply the transport named in the process-level 'ready' ("shm" or
+     * "pipe"). Call it from the frame handler on the thread that reads
+     * this bridge, so the frames after 'ready' are read the new way.
+     */
+    void settle_transport(const std::string& transport);
+    
+    bool shared_memory_active() const { return shm_active_; }
+    
+    /**
+     * The options.audio_bytes region placed after the rings, or nullptr
+     * (no shared memory). Usable once shared_memory_active().
+     */
+    void* audio_region() const;
+    
+    /**
+     * Ring the doorbell if the script is asleep, e.g. after publishing a
+     * signal block it should pick up without a message. Never blocks.
+     */
+    void wake_script();
+    
+    /**
+     * Terminate the child process. Returns immediately; the child is
+     * reaped (and killed if it doesn't exit) in the background.
      */
     void terminate();
     
+    /**
+     * Descriptor number the shared region is inherited on in the child
+     */
+    static constexpr int kShmChildFd = 3;
+    
 private:
     std::string runtime_path_;
     std::string wrapper_path_;
     std::string script_path_;
+    BridgeOptions options_;
     
     pid_t child_pid_;
+    mutable bool child_exited_;  // Reaped by reap()
+    mutable int exit_code_;
+    mutable int exit_signal_;
+    int exit_fd_;
     
     int stdin_pipe_[2];   // We write to [1], child reads from [0]
     int stdout_pipe_[2];  // Child writes to [1], we read from [0]
@@ -67,9 +254,52 @@ private:
     
     std::function<void(const std::string&)> message_callback_;
     
-    // Buffer for reading lines
-    std::string read_buffer_;
+    // Linear buffer for reading lines/frames: live bytes are
+    // [read_start_, read_end_), lines are scanned from read_scan_
+    std::vector<char> read_buffer_;
+    size_t read_start_;
+    size_t read_end_;
+    size_t read_scan_;
+    bool stdout_eof_;
+    
+    // Shared memory transport
+    SharedMemory shm_;
+    ShmRing to_js_;
+    ShmRing from_js_;
+    // Set by the reading thread (see settle_transport), read when writing
+    std::atomic<bool> shm_active_;
+    std::atomic<bool> awaiting_transport_;  // Output held until 'ready' picks pipe or rings
+    
+    // Outbound queue: one encoded record per message
+    struct OutRecord {
+        std::string bytes;
+        uintptr_t key;
+        uint16_t port;
+        uint32_t channel;
+    };
+    std::deque<OutRecord> out_queue_;
+    size_t out_offset_;                    // Bytes of the front record already written
+    size_t out_bytes_;                     // Total bytes queued
+    std::vector<std::string> out_spare_;   // Recycled record buffers
+    uint64_t dropped_messages_;
+    bool block_expired_;  // BLOCK gave up waiting: drop until the queue has room
     
+    void encode_frame(std::string& out, const std::string& payload, FrameType type, uint16_t port,
+                      const FrameExtensions& ext) const;
+    void recycle_front();
+    void recycle(std::string& bytes);
+    bool make_queue_room(uintptr_t key, uint16_t port, uint32_t channel, std::string& record);
+    bool wait_writable(std::chrono::steady_clock::time_point deadline);  // False once past deadline
+    size_t receive_pipe(const std::function<void(const FrameView&)>& handler);
+    size_t parse_buffered(const std::function<void(const FrameView&)>& handler);
+    void make_read_room();
+    bool decode_record(const char* data, size_t size, FrameView& out_frame) const;
+    bool create_shared_memory();
+    bool flush_pipe();
+    bool flush_shared();
+    size_t receive_shared(const std::function<void(const FrameView&)>& handler);
+    bool drain_doorbells();
+    void ring_doorbell();
     void set_nonblocking(int fd);
     std::string read_line_nonblocking(int fd);
 };
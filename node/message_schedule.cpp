@@ -0,0 +1,57 @@
+/**
+ * message_schedule.cpp
+ * 
+ * Outlet messages a script stamped with a future logical time
+ */
+
+#include "message_schedule.h"
+
+namespace pdnode {
+
+// Spare messages kept for reuse; a burst beyond this is freed again
+static const size_t kMaxSpare = 256;
+
+MessageSchedule::~MessageSchedule() {
+    clear();
+    for (InboundMessage* msg : spare_) {
+        delete msg;
+    }
+}
+
+void MessageSchedule::add(const InboundMessage& msg, double due) {
+    InboundMessage* copy;
+    if (!spare_.empty()) {
+        copy = spare_.back();
+        spare_.pop_back();
+    } else {
+        copy = new InboundMessage();
+    }
+    copy->assign(msg);
+    
+    // Equal keys go after the ones already there
+    queue_.emplace(due, copy);
+}
+
+InboundMessage* MessageSchedule::pop() {
+    auto it = queue_.begin();
+    InboundMessage* msg = it->second;
+    queue_.erase(it);
+    return msg;
+}
+
+void MessageSchedule::recycle(InboundMessage* msg) {
+    if (spare_.size() >= kMaxSpare) {
+        delete msg;
+        return;
+    }
+    spare_.push_back(msg);
+}
+
+void MessageSchedule::clear() {
+    for (auto& entry : queue_) {
+        recycle(entry.second);
+    }
+    queue_.clear();
+}
+
+} // namespace pdnode
@@ -0,0 +1,69 @@
+/**
+ * message_schedule.h
+ * 
+ * Outlet messages a script stamped with a future logical time
+ */
+
+#ifndef PD_NODE_MESSAGE_SCHEDULE_H
+#define PD_NODE_MESSAGE_SCHEDULE_H
+
+#include "inbound.h"
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace pdnode {
+
+/**
+ * Message Schedule - copies of timestamped messages, earliest first
+ * 
+ * Due times are Pd systimes (see clock_set()), so the clock firing for a
+ * message compares equal to it. Messages due at the same time keep the
+ * order they arrived in. Popped
+ * messages are handed back with recycle() so their buffers are reused.
+ * Not thread-safe: only used from Pd's main thread.
+ */
+class MessageSchedule {
+public:
+    MessageSchedule() = default;
+    ~MessageSchedule();
+    
+    MessageSchedule(const MessageSchedule&) = delete;
+    MessageSchedule& operator=(const MessageSchedule&) = delete;
+    
+    /**
+     * Keep a copy of `msg` until systime `due`
+     */
+    void add(const InboundMessage& msg, double due);
+    
+    bool empty() const { return queue_.empty(); }
+    size_t size() const { return queue_.size(); }
+    
+    /**
+     * Systime the earliest message is due at (the schedule must not be empty)
+     */
+    double next_due() const { return queue_.begin()->first; }
+    
+    /**
+     * Take the earliest message out of the schedule
+     */
+    InboundMessage* pop();
+    
+    /**
+     * Give back a message from pop() once it has been emitted
+     */
+    void recycle(InboundMessage* msg);
+    
+    /**
+     * Drop everything still scheduled
+     */
+    void clear();
+    
+private:
+    std::multimap<double, InboundMessage*> queue_;
+    std::vector<InboundMessage*> spare_;
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_MESSAGE_SCHEDULE_H
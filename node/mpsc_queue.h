@@ -0,0 +1,73 @@
+/**
+ * mpsc_queue.h
+ * 
+ * Lock-free intrusive multi-producer/single-consumer queue
+ */
+
+#ifndef PD_NODE_MPSC_QUEUE_H
+#define PD_NODE_MPSC_QUEUE_H
+
+#include <atomic>
+
+namespace pdnode {
+
+/**
+ * Unbounded FIFO of caller-owned nodes (Vyukov's algorithm)
+ * 
+ * T must have a `std::atomic<T*> next` member and be default
+ * constructible (the queue keeps one as a stub). push() never blocks and
+ * may be called from any thread; pop() only from the single consumer.
+ * pop() can return nullptr while a push is half done, so producers must
+ * wake the consumer after pushing.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) {}
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+    
+    void push(T* node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        T* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+    
+    T* pop() {
+        T* tail = tail_;
+        T* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (!next) {
+                return nullptr;
+            }
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail_ = next;
+            return tail;
+        }
+        
+        // `tail` is the last node: put the stub behind it so it can leave
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        push(&stub_);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next) {
+            tail_ = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+private:
+    T stub_;
+    std::atomic<T*> head_;  // Last pushed (producers)
+    T* tail_;               // Next to pop (consumer)
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_MPSC_QUEUE_H
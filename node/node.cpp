@@ -9,25 +9,56 @@
 #include <g_canvas.h>
 #include "runtime_detector.h"
 #include "ipc_bridge.h"
+#include "process_pool.h"
+#include "shared_host.h"
+#include "io_thread.h"
+#include "reactor.h"
+#include "inbound.h"
+#include "atom_codec.h"
+#include "atom_pool.h"
+#include "audio_exchange.h"
+#include "shared_memory.h"
+#include "message_schedule.h"
+#include "instance_stats.h"
 #include "json.hpp"
+#include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
+#include <cstring>
 
 using namespace pdnode;
 using json = nlohmann::json;
 
 static t_class *node_class;
+static t_class *node_tilde_class;  // [node~]: the same object with signal inlets/outlets
+static t_clock *pool_clock;  // Refills the process pool outside object creation
 
 typedef struct _node {
     t_object x_obj;
+    t_float signal_in;  // [node~]: left inlet scalar (must follow x_obj)
     t_canvas *canvas;
     t_outlet *outlet;
-    t_clock *poll_clock;
+    t_outlet *info_outlet;  // Right outlet: how the process ended
+    t_clock *flush_clock;  // Writes out everything queued during a tick
+    bool flush_armed;
+    uint64_t reported_drops;  // Overflow drops already warned about
     
     std::string script_path;
     Runtime runtime;
-    RuntimeDetector* detector;
-    IPCBridge* bridge;
+    IPCBridge* bridge;      // Own process, or the shared host's bridge
+    SharedHost* host;       // Set when running in a shared host
+    uint32_t channel;       // Our script's channel in the host (0 = own process)
+    uint64_t io_watch;      // Read by the I/O thread (0 = on Pd's thread)
+    std::vector<t_symbol*> *symbols;  // Interned by the script, by id
+    AtomPool<t_atom> *atom_pool;  // Buffers reused by emit_outlet
+    AudioExchange *audio;   // [node~]: signal blocks shared with the script
+    t_clock *wake_clock;    // [node~]: rings the script's doorbell after a DSP tick
+    std::map<std::string, SharedMemory> *arrays;  // Mirrors of shared Pd arrays, by name
+    MessageSchedule *scheduled;  // Outlet messages stamped for later
+    t_clock *schedule_clock;     // Fires when the earliest of them is due
+    bool stamp_time;  // --time: inlet messages carry Pd's logical time
+    InstanceStats *stats;  // Latency and traffic, reported on [stats(
     
     bool ready;  // True after receiving 'ready' message from JS
 } t_node;
@@ -40,8 +71,45 @@ static void node_float(t_node *x, t_float f);
 static void node_symbol(t_node *x, t_symbol *s);
 static void node_list(t_node *x, t_symbol *s, int argc, t_atom *argv);
 static void node_anything(t_node *x, t_symbol *s, int argc, t_atom *argv);
-static void node_poll(t_node *x);
-static void handle_json_message(t_node *x, const std::string& json_str);
+static void node_stdout_ready(t_node *x, int fd);
+static void node_stderr_ready(t_node *x, int fd);
+static void node_exit_ready(t_node *x, int fd);
+static void node_process_ended(t_node *x);
+static void node_flush(t_node *x);
+static void node_rescan(t_node *x);
+static void node_pool(t_node *x, t_floatarg size);
+static void node_pool_refill(void *unused);
+static void node_schedule_tick(t_node *x);
+static void node_stats(t_node *x, t_symbol *arg);
+static void node_share(t_node *x, t_symbol *name);
+static void node_unshare(t_node *x, t_symbol *name);
+static void node_tilde_dsp(t_node *x, t_signal **sp);
+static t_int *node_tilde_perform(t_int *w);
+static void node_tilde_wake(t_node *x);
+static void node_schedule_flush(t_node *x);
+static void node_close_bridge(t_node *x);
+static void node_host_stdout_ready(SharedHost *host, int fd);
+static void node_host_stderr_ready(SharedHost *host, int fd);
+static void node_host_exit_ready(SharedHost *host, int fd);
+static void node_host_ended(SharedHost *host);
+static void node_report_exit(t_node *x, const IPCBridge& bridge);
+static void node_receive(t_node *x);
+static void node_post_stderr(t_node *x, const std::string& text);
+static void node_io_message(t_node *x, InboundMessage& msg);
+static void node_host_post_stderr(SharedHost *host, const std::string& text);
+static void node_host_io_message(SharedHost *host, InboundMessage& msg);
+static void node_io_ready(void *unused, int fd);
+static void node_add_fd(int fd, t_fdpollfn fn, void *ptr);
+static void node_remove_fd(int fd);
+static void node_reactor_ready(void *unused, int fd);
+static uint64_t node_watch_io(IPCBridge *bridge, const IOThread::Sink& sink);
+static void send_to_js(t_node *x, t_symbol *selector, int argc, t_atom *argv);
+static void handle_message(t_node *x, const InboundMessage& msg);
+static void handle_ready(t_node *x);
+static void emit_outlet(t_node *x, const InboundMessage& msg);
+static void schedule_outlet(t_node *x, const InboundMessage& msg);
+static void handle_array_written(t_node *x, const std::string& name);
+static t_symbol *resolve_symbol(t_node *x, const InboundMessage& msg, const InboundAtom& atom);
 
 /**
  * External setup - called when PD loads the external
@@ -63,24 +131,185 @@ extern "C" void node_setup(void) {
     class_addsymbol(node_class, node_symbol);
     class_addlist(node_class, node_list);
     class_addanything(node_class, node_anything);
+    class_addmethod(node_class, (t_method)node_rescan, gensym("rescan"), A_NULL);
+    class_addmethod(node_class, (t_method)node_pool, gensym("pool"), A_FLOAT, A_NULL);
+    class_addmethod(node_class, (t_method)node_share, gensym("share"), A_SYMBOL, A_NULL);
+    class_addmethod(node_class, (t_method)node_unshare, gensym("unshare"), A_SYMBOL, A_NULL);
+    class_addmethod(node_class, (t_method)node_stats, gensym("stats"), A_DEFSYM, A_NULL);
+    
+    // [node~] takes floats as signal values on its left inlet
+    node_tilde_class = class_new(
+        gensym("node~"),
+        (t_newmethod)node_new,
+        (t_method)node_free,
+        sizeof(t_node),
+        CLASS_DEFAULT,
+        A_GIMME,
+        0
+    );
+    // t_node isn't standard-layout, so no offsetof (CLASS_MAINSIGNALIN)
+    class_domainsignalin(node_tilde_class, (int)sizeof(t_object));
+    class_addbang(node_tilde_class, node_bang);
+    class_addsymbol(node_tilde_class, node_symbol);
+    class_addlist(node_tilde_class, node_list);
+    class_addanything(node_tilde_class, node_anything);
+    class_addmethod(node_tilde_class, (t_method)node_rescan, gensym("rescan"), A_NULL);
+    class_addmethod(node_tilde_class, (t_method)node_pool, gensym("pool"), A_FLOAT, A_NULL);
+    class_addmethod(node_tilde_class, (t_method)node_share, gensym("share"), A_SYMBOL, A_NULL);
+    class_addmethod(node_tilde_class, (t_method)node_unshare, gensym("unshare"), A_SYMBOL, A_NULL);
+    class_addmethod(node_tilde_class, (t_method)node_stats, gensym("stats"), A_DEFSYM, A_NULL);
+    class_addmethod(node_tilde_class, (t_method)node_tilde_dsp, gensym("dsp"), A_CANT, A_NULL);
+    class_sethelpsymbol(node_tilde_class, gensym("node"));
+    
+    pool_clock = clock_new(nullptr, (t_method)node_pool_refill);
     
     post("[node] pd-node v0.1.0 - Modern JavaScript & TypeScript for Pure Data");
 }
 
+/**
+ * The same binary, loaded under the name [node~]
+ */
+extern "C" void node_tilde_setup(void) {
+    node_setup();
+}
+
 /**
  * Create new [node] object
  */
 static void *node_new(t_symbol *s, int argc, t_atom *argv) {
-    t_node *x = (t_node *)pd_new(node_class);
+    bool tilde = (s == gensym("node~"));
+    t_node *x = (t_node *)pd_new(tilde ? node_tilde_class : node_class);
     
     // Get canvas for relative path resolution
     x->canvas = canvas_getcurrent();
     x->ready = false;
+    x->flush_armed = false;
+    x->stamp_time = false;
+    x->outlet = nullptr;
+    x->info_outlet = nullptr;
+    x->reported_drops = 0;
+    x->io_watch = 0;
+    x->symbols = new std::vector<t_symbol*>();
+    x->atom_pool = new AtomPool<t_atom>();
+    x->arrays = new std::map<std::string, SharedMemory>();
+    x->scheduled = new MessageSchedule();
+    x->schedule_clock = clock_new(x, (t_method)node_schedule_tick);
+    x->stats = new InstanceStats();
+    
+    // Parse leading flags: [node --shm script.js]
+    BridgeOptions options;
+    const char *host_name = nullptr;
+    std::string share_dir;       // --share: host named after the script's directory
+    bool share = false;
+    bool queue_flags = false;  // --overflow or --queue given
+    bool io_thread = false;
+    int signal_inputs = 1;
+    int signal_outputs = 1;
+    int delay = 1;
+    while (argc > 0 && argv[0].a_type == A_SYMBOL
+           && strncmp(atom_getsymbol(&argv[0])->s_name, "--", 2) == 0) {
+        const char *flag = atom_getsymbol(&argv[0])->s_name;
+        if (strcmp(flag, "--shm") == 0) {
+            options.transport = Transport::SHARED_MEMORY;
+        } else if (strcmp(flag, "--json") == 0) {
+            options.framing = Framing::LINES;
+        } else if (strcmp(flag, "--thread") == 0) {
+            io_thread = true;
+        } else if (strcmp(flag, "--time") == 0) {
+            x->stamp_time = true;
+        } else if (strcmp(flag, "--overflow") == 0 && argc > 1 && argv[1].a_type == A_SYMBOL) {
+            const char *policy = atom_getsymbol(&argv[1])->s_name;
+            if (strcmp(policy, "block") == 0) {
+                options.overflow = OverflowPolicy::BLOCK;
+            } else if (strcmp(policy, "drop-oldest") == 0) {
+                options.overflow = OverflowPolicy::DROP_OLDEST;
+            } else if (strcmp(policy, "drop-newest") == 0) {
+                options.overflow = OverflowPolicy::DROP_NEWEST;
+            } else if (strcmp(policy, "coalesce") == 0) {
+                options.overflow = OverflowPolicy::COALESCE_LATEST;
+            } else {
+                pd_error(x, "[node] unknown overflow policy: %s", policy);
+            }
+            queue_flags = true;
+            argc--;
+            argv++;
+        } else if (strcmp(flag, "--host") == 0 && argc > 1 && argv[1].a_type == A_SYMBOL) {
+            host_name = atom_getsymbol(&argv[1])->s_name;
+            argc--;
+            argv++;
+        } else if (strcmp(flag, "--share") == 0) {
+            share = true;
+        } else if (strcmp(flag, "--queue") == 0 && argc > 1 && argv[1].a_type == A_FLOAT) {
+            int limit = (int)atom_getfloat(&argv[1]);
+            if (limit > 0) {
+                options.queue_limit = (size_t)limit;
+                queue_flags = true;
+            } else {
+                pd_error(x, "[node] queue size must be positive");
+            }
+            argc--;
+            argv++;
+        } else if (strcmp(flag, "--atoms") == 0 && argc > 1 && argv[1].a_type == A_FLOAT) {
+            int limit = (int)atom_getfloat(&argv[1]);
+            if (limit > 0) {
+                x->atom_pool->set_max_atoms((size_t)limit);
+            } else {
+                pd_error(x, "[node] atom buffer size must be positive");
+            }
+            argc--;
+            argv++;
+        } else if (tilde && (strcmp(flag, "--in") == 0 || strcmp(flag, "--out") == 0
+                             || strcmp(flag, "--delay") == 0) && argc > 1 && argv[1].a_type == A_FLOAT) {
+            int value = (int)atom_getfloat(&argv[1]);
+            if (strcmp(flag, "--delay") == 0) {
+                delay = value > 1 ? value : 1;
+            } else if (strcmp(flag, "--in") == 0 && (value < 1 || value > 64)) {
+                // The left inlet always takes a signal
+                pd_error(x, "[node~] --in must be between 1 and 64");
+            } else if (value < 0 || value > 64) {
+                pd_error(x, "[node~] --out must be between 0 and 64");
+            } else if (strcmp(flag, "--in") == 0) {
+                signal_inputs = value;
+            } else {
+                signal_outputs = value;
+            }
+            argc--;
+            argv++;
+        } else {
+            pd_error(x, "[node] unknown flag: %s", flag);
+        }
+        argc--;
+        argv++;
+    }
+    
+    // [node~]: signal inlets and outlets come first, messages still work on
+    // the left inlet. Blocks travel through shared memory, in a process of
+    // its own.
+    if (tilde) {
+        for (int i = 1; i < signal_inputs; i++) {
+            inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+        }
+        for (int i = 0; i < signal_outputs; i++) {
+            outlet_new(&x->x_obj, &s_signal);
+        }
+        x->audio = new AudioExchange((uint32_t)signal_inputs, (uint32_t)signal_outputs, (uint32_t)delay + 1);
+        x->wake_clock = clock_new(x, (t_method)node_tilde_wake);
+        options.transport = Transport::SHARED_MEMORY;
+        options.audio_bytes = x->audio->region_size();
+        if (host_name || share) {
+            pd_error(x, "[node~] can't run in a shared host, ignoring --host/--share");
+            host_name = nullptr;
+            share = false;
+        }
+    }
     
     // Check if script argument provided
     if (argc < 1 || argv[0].a_type != A_SYMBOL) {
         pd_error(x, "[node] requires script path as argument");
-        pd_error(x, "[node] usage: [node script.js]");
+        pd_error(x, "[node] usage: [node [--shm] [--json] [--thread] [--time] [--host name] [--share] [--overflow policy] [--queue n] [--atoms n] script.js]");
+        if (tilde) {
+            pd_error(x, "[node~] also takes: [--in n] [--out n] [--delay blocks]");
+        }
         return x;
     }
     
@@ -104,22 +333,30 @@ static void *node_new(t_symbol *s, int argc, t_atom *argv) {
         }
     }
     
-    // Create runtime detector
-    x->detector = new RuntimeDetector();
+    // Scripts from one directory share a host named after it (an explicit
+    // --host wins)
+    if (share && !host_name) {
+        share_dir = x->script_path.substr(0, x->script_path.find_last_of('/'));
+        host_name = share_dir.c_str();
+    }
+    
+    // Runtimes are detected once per Pd process
+    RuntimeDetector& detector = RuntimeDetector::instance();
     
-    // Detect appropriate runtime for this script
-    x->runtime = x->detector->get_runtime_for_script(x->script_path);
+    // Pick the appropriate runtime for this script
+    x->runtime = detector.get_runtime_for_script(x->script_path);
     
     if (x->runtime == Runtime::NONE) {
-        std::string error_msg = x->detector->get_error_message(x->script_path);
+        std::string error_msg = detector.get_error_message(x->script_path);
         pd_error(x, "%s", error_msg.c_str());
         return x;
     }
     
     // Get runtime path
-    std::string runtime_path = x->detector->get_runtime_path(x->runtime);
-    std::string runtime_name = x->detector->get_runtime_name(x->runtime);
+    std::string runtime_path = detector.get_runtime_path(x->runtime);
+    std::string runtime_name = detector.get_runtime_name(x->runtime);
     
+    // No version here: reading it may spawn the runtime ([rescan( shows it)
     post("[node] Using %s runtime: %s", runtime_name.c_str(), runtime_path.c_str());
     post("[node] Script: %s", x->script_path.c_str());
     
@@ -128,25 +365,105 @@ static void *node_new(t_symbol *s, int argc, t_atom *argv) {
     const char *ext_path = class_gethelpdir(node_class);
     snprintf(wrapper_path, MAXPDSTRING, "%s/wrapper.js", ext_path);
     
-    // Create IPC bridge
-    x->bridge = new IPCBridge(runtime_path, std::string(wrapper_path), x->script_path);
-    
-    // Spawn the process
-    if (!x->bridge->spawn()) {
-        pd_error(x, "[node] Failed to spawn %s process", runtime_name.c_str());
-        delete x->bridge;
-        x->bridge = nullptr;
+    if (host_name) {
+        // Load the script into a runtime shared with other [node --host] objects
+        bool created;
+        x->host = SharedHost::acquire(host_name, runtime_path, std::string(wrapper_path), options, created);
+        if (!x->host) {
+            pd_error(x, "[node] Failed to spawn %s host '%s'", runtime_name.c_str(), host_name);
+            return x;
+        }
+        if (created) {
+            post("[node] Started shared %s host '%s'", runtime_name.c_str(), host_name);
+            SharedHost *host = x->host;
+            if (io_thread) {
+                // The first object decides for the whole host
+                host->set_io_watch(node_watch_io(&host->bridge(), [host](InboundMessage& msg) {
+                    node_host_io_message(host, msg);
+                }));
+            } else {
+                node_add_fd(host->bridge().stdout_fd(), (t_fdpollfn)node_host_stdout_ready, host);
+                node_add_fd(host->bridge().stderr_fd(), (t_fdpollfn)node_host_stderr_ready, host);
+                if (host->bridge().exit_fd() >= 0) {
+                    node_add_fd(host->bridge().exit_fd(), (t_fdpollfn)node_host_exit_ready, host);
+                }
+            }
+        }
+        
+        // The host may have booted long ago. Its queue is shared by every
+        // script in it, so the object that started it set the policy.
+        x->bridge = &x->host->bridge();
+        const BridgeOptions& host_options = x->bridge->options();
+        if (!created && queue_flags && (host_options.overflow != options.overflow
+                                        || host_options.queue_limit != options.queue_limit)) {
+            pd_error(x, "[node] Host '%s' keeps the --overflow/--queue settings of the object that started it",
+                     host_name);
+        }
+        x->ready = x->host->is_ready();
+        x->channel = x->host->open_channel(x->script_path, {
+            [x](const InboundMessage& msg) { handle_message(x, msg); },
+            [x]() {
+                node_report_exit(x, x->host->bridge());
+                node_close_bridge(x);
+            }
+        });
+        
+        x->outlet = outlet_new(&x->x_obj, &s_anything);
+        x->info_outlet = outlet_new(&x->x_obj, &s_anything);
+        x->flush_clock = clock_new(x, (t_method)node_flush);
+        node_schedule_flush(x);
         return x;
     }
     
-    post("[node] Process spawned successfully");
+    // Prefer an already booted process from the pool (if enabled), replace it later
+    if (!tilde && ProcessPool::instance().size() > 0) {
+        x->bridge = ProcessPool::instance().acquire(runtime_path, std::string(wrapper_path), x->script_path, options);
+        clock_delay(pool_clock, 0);
+    }
     
-    // Create outlet
+    if (x->bridge) {
+        post("[node] Using pooled %s process", runtime_name.c_str());
+    } else {
+        // Create IPC bridge
+        x->bridge = new IPCBridge(runtime_path, std::string(wrapper_path), x->script_path, options);
+        
+        // Spawn the process
+        if (!x->bridge->spawn()) {
+            pd_error(x, "[node] Failed to spawn %s process", runtime_name.c_str());
+            delete x->bridge;
+            x->bridge = nullptr;
+            return x;
+        }
+        
+        post("[node] Process spawned successfully");
+    }
+    if (x->audio && x->bridge->audio_region()) {
+        x->audio->attach(x->bridge->audio_region());
+    }
+    
+    // Create outlets
     x->outlet = outlet_new(&x->x_obj, &s_anything);
+    x->info_outlet = outlet_new(&x->x_obj, &s_anything);
+    
+    // Let Pd's scheduler wake us when the child writes something, or have
+    // the I/O thread read and decode it
+    x->flush_clock = clock_new(x, (t_method)node_flush);
+    if (io_thread) {
+        x->io_watch = node_watch_io(x->bridge, [x](InboundMessage& msg) {
+            node_io_message(x, msg);
+        });
+    } else {
+        node_add_fd(x->bridge->stdout_fd(), (t_fdpollfn)node_stdout_ready, x);
+        node_add_fd(x->bridge->stderr_fd(), (t_fdpollfn)node_stderr_ready, x);
+        if (x->bridge->exit_fd() >= 0) {
+            node_add_fd(x->bridge->exit_fd(), (t_fdpollfn)node_exit_ready, x);
+        }
+    }
     
-    // Set up polling clock (poll every 1ms)
-    x->poll_clock = clock_new(x, (t_method)node_poll);
-    clock_delay(x->poll_clock, 1);
+    // A pooled process already has its load request queued
+    if (x->bridge->has_pending_output()) {
+        node_schedule_flush(x);
+    }
     
     return x;
 }
@@ -155,209 +472,992 @@ static void *node_new(t_symbol *s, int argc, t_atom *argv) {
  * Free [node] object
  */
 static void node_free(t_node *x) {
-    if (x->poll_clock) {
-        clock_free(x->poll_clock);
+    if (x->flush_clock) {
+        clock_free(x->flush_clock);
+    }
+    if (x->wake_clock) {
+        clock_free(x->wake_clock);
     }
     
-    if (x->bridge) {
-        x->bridge->terminate();
-        delete x->bridge;
+    node_close_bridge(x);
+    if (x->schedule_clock) {
+        clock_free(x->schedule_clock);
+    }
+    delete x->scheduled;
+    delete x->stats;
+    delete x->symbols;
+    delete x->atom_pool;
+    delete x->audio;
+    delete x->arrays;  // Removes the mirror files
+}
+
+/**
+ * Re-detect runtimes for the whole Pd process (e.g. after installing Bun)
+ * 
+ * Only affects objects created afterwards; running scripts keep their runtime.
+ */
+static void node_rescan(t_node *x) {
+    RuntimeDetector& detector = RuntimeDetector::instance();
+    detector.rescan();
+    post("%s", detector.get_info_string().c_str());
+}
+
+/**
+ * Set how many booted processes are kept waiting per runtime (0 disables)
+ */
+static void node_pool(t_node *x, t_floatarg size) {
+    ProcessPool::instance().set_size(size > 0 ? (size_t)size : 0);
+    clock_delay(pool_clock, 0);
+}
+
+/**
+ * Spawn pooled processes one at a time, between scheduler ticks
+ */
+static void node_pool_refill(void *unused) {
+    if (ProcessPool::instance().refill_step()) {
+        clock_delay(pool_clock, 5);
+    }
+}
+
+/**
+ * Emit the scheduled outlet messages that are due, then wait for the next
+ */
+static void node_schedule_tick(t_node *x) {
+    // Pd's systime is the due time of the message we were set for
+    double now = clock_getsystimeafter(0);
+    while (!x->scheduled->empty() && x->scheduled->next_due() <= now) {
+        InboundMessage *msg = x->scheduled->pop();
+        emit_outlet(x, *msg);
+        x->scheduled->recycle(msg);
+    }
+    if (!x->scheduled->empty()) {
+        clock_set(x->schedule_clock, x->scheduled->next_due());
     }
+}
+
+// Send one statistics line from the info outlet
+static void node_stats_line(t_node *x, const char *name, std::initializer_list<double> values) {
+    std::vector<t_atom> atoms(values.size());
+    size_t i = 0;
+    for (double value : values) {
+        SETFLOAT(&atoms[i], (t_float)value);  // A macro: no i++ inside
+        i++;
+    }
+    outlet_anything(x->info_outlet, gensym(name), (int)atoms.size(), atoms.data());
+}
+
+/**
+ * Report statistics from the right outlet: [stats(, or [stats reset( to
+ * start counting again
+ * 
+ *   latency count min mean p50 p90 p99 p99.9 max   inlet -> outlet round
+ *                                                   trip, in ms
+ *   messages out in     to / from the script
+ *   bytes out in
+ *   parse count mean p99 max                        decoding, in us
+ *   queue depth max dropped scheduled               outbound queue, messages
+ *                                                   held for pd.outletAt()
+ *   spills n            outlet lists too long for the atom buffers
+ *   underruns n         [node~]: blocks the script was late for
+ */
+static void node_stats(t_node *x, t_symbol *arg) {
+    // node_new() gave up before creating the outlets (no script, no runtime)
+    if (!x->info_outlet) {
+        pd_error(x, "[node] stats: no script running");
+        return;
+    }
+    InstanceStats& stats = *x->stats;
+    if (arg == gensym("reset")) {
+        stats.reset();
+        return;
+    }
+    if (arg != &s_) {
+        pd_error(x, "[node] stats: unknown argument '%s'", arg->s_name);
+        return;
+    }
+    
+    const Histogram& latency = stats.latency();
+    node_stats_line(x, "latency", {
+        (double)latency.count(), latency.min() / 1000.0, latency.mean() / 1000.0,
+        latency.percentile(0.5) / 1000.0, latency.percentile(0.9) / 1000.0,
+        latency.percentile(0.99) / 1000.0, latency.percentile(0.999) / 1000.0, latency.max() / 1000.0
+    });
+    node_stats_line(x, "messages", { (double)stats.messages_out(), (double)stats.messages_in() });
+    node_stats_line(x, "bytes", { (double)stats.bytes_out(), (double)stats.bytes_in() });
     
-    if (x->detector) {
-        delete x->detector;
+    const Histogram& parse = stats.parse_time();
+    node_stats_line(x, "parse", {
+        (double)parse.count(), parse.mean() / 1000.0, parse.percentile(0.99) / 1000.0, parse.max() / 1000.0
+    });
+    node_stats_line(x, "queue", {
+        x->bridge ? (double)x->bridge->pending_output() : 0, (double)stats.max_queue_depth(),
+        x->bridge ? (double)x->bridge->dropped_messages() : 0, (double)x->scheduled->size()
+    });
+    node_stats_line(x, "spills", { (double)x->atom_pool->spills() });
+    if (x->audio) {
+        node_stats_line(x, "underruns", { (double)x->audio->underruns() });
     }
 }
 
 /**
- * Handle bang message
+ * Mirror a Pd array for the script: [share name(
+ * 
+ * The floats are copied into a shared file the script maps as a
+ * Float32Array (pd.array(name)). Send it again after the array changed to
+ * copy it again; the script's 'array' handlers run each time.
  */
-static void node_bang(t_node *x) {
-    if (!x->bridge || !x->ready) {
+static void node_share(t_node *x, t_symbol *name) {
+    if (!x->bridge) {
+        pd_error(x, "[node] No runtime process to share '%s' with", name->s_name);
+        return;
+    }
+    t_garray *array = (t_garray *)pd_findbyclass(name, garray_class);
+    int length;
+    t_word *words;
+    if (!array || !garray_getfloatwords(array, &length, &words)) {
+        pd_error(x, "[node] No float array named '%s'", name->s_name);
         return;
     }
     
-    json msg = {
-        {"type", "message"},
-        {"inlet", 0},
-        {"selector", "bang"},
-        {"args", json::array()}
-    };
+    // A new file only when the size changed; the script remaps by path
+    SharedMemory& mirror = (*x->arrays)[name->s_name];
+    size_t bytes = (size_t)std::max(length, 1) * sizeof(float);
+    if (mirror.size() != bytes && !mirror.create_file(bytes)) {
+        x->arrays->erase(name->s_name);
+        pd_error(x, "[node] Could not share array '%s'", name->s_name);
+        return;
+    }
+    float *data = (float *)mirror.data();
+    for (int i = 0; i < length; i++) {
+        data[i] = words[i].w_float;
+    }
     
-    x->bridge->send_message(msg.dump());
+    x->bridge->share_array(name->s_name, mirror.path(), (size_t)length, x->channel);
+    node_schedule_flush(x);
 }
 
 /**
- * Handle float message
+ * Stop mirroring a Pd array: [unshare name(
  */
-static void node_float(t_node *x, t_float f) {
-    if (!x->bridge || !x->ready) {
+static void node_unshare(t_node *x, t_symbol *name) {
+    auto it = x->arrays->find(name->s_name);
+    if (it == x->arrays->end()) {
+        pd_error(x, "[node] Array '%s' is not shared", name->s_name);
         return;
     }
+    // The script keeps a valid (if stale) mapping until it drops it
+    x->arrays->erase(it);
+    if (x->bridge) {
+        x->bridge->share_array(name->s_name, std::string(), 0, x->channel);
+        node_schedule_flush(x);
+    }
+}
+
+/**
+ * Add [node~] to the DSP chain: the perform routine gets the object, the
+ * block size and one vector per signal inlet and outlet
+ */
+static void node_tilde_dsp(t_node *x, t_signal **sp) {
+    AudioExchange *audio = x->audio;
+    int n = sp[0]->s_n;
+    if (!audio->configure((uint32_t)n, sp[0]->s_sr) && audio->valid()) {
+        pd_error(x, "[node~] Block size %d is larger than %u, outlets stay silent", n, AudioExchange::kMaxBlock);
+    }
     
-    json msg = {
-        {"type", "message"},
-        {"inlet", 0},
-        {"selector", "float"},
-        {"args", json::array({f})}
-    };
+    std::vector<t_int> args(2 + audio->inputs() + audio->outputs());
+    args[0] = (t_int)x;
+    args[1] = (t_int)n;
+    for (size_t i = 2; i < args.size(); i++) {
+        args[i] = (t_int)sp[i - 2]->s_vec;
+    }
+    dsp_addv(node_tilde_perform, (int)args.size(), args.data());
+}
+
+/**
+ * Exchange one block with the script, never waiting for it
+ * 
+ * This block's input goes out now; what comes back is the output of the
+ * block sent `--delay` blocks ago, or silence if the script isn't done.
+ */
+static t_int *node_tilde_perform(t_int *w) {
+    t_node *x = (t_node *)w[1];
+    int n = (int)w[2];
+    AudioExchange *audio = x->audio;
+    uint32_t inputs = audio->inputs();
+    uint32_t outputs = audio->outputs();
+    bool live = x->ready && x->bridge && x->bridge->shared_memory_active()
+                && audio->valid() && audio->block_size() == (uint32_t)n;
     
-    x->bridge->send_message(msg.dump());
+    // Inputs first: Pd may use one vector for an inlet and an outlet
+    if (live) {
+        for (uint32_t i = 0; i < inputs; i++) {
+            const t_sample *in = (const t_sample *)w[3 + i];
+            float *block = audio->input(i);
+            for (int k = 0; k < n; k++) {
+                block[k] = in[k];
+            }
+        }
+    }
+    
+    bool done = live && audio->collect();
+    for (uint32_t o = 0; o < outputs; o++) {
+        t_sample *out = (t_sample *)w[3 + inputs + o];
+        if (done) {
+            const float *block = audio->output(o);
+            for (int k = 0; k < n; k++) {
+                out[k] = block[k];
+            }
+        } else {
+            for (int k = 0; k < n; k++) {
+                out[k] = 0;
+            }
+        }
+    }
+    
+    // No system calls in here: the doorbell is rung from the scheduler
+    if (live) {
+        audio->publish();
+        clock_delay(x->wake_clock, 0);
+    }
+    return w + 3 + inputs + outputs;
+}
+
+/**
+ * Wake the script for the block just published, once the DSP tick is over
+ */
+static void node_tilde_wake(t_node *x) {
+    if (x->bridge) {
+        x->bridge->wake_script();
+    }
+}
+
+/**
+ * Handle bang message
+ */
+static void node_bang(t_node *x) {
+    send_to_js(x, &s_bang, 0, nullptr);
+}
+
+/**
+ * Handle float message
+ */
+static void node_float(t_node *x, t_float f) {
+    t_atom a;
+    SETFLOAT(&a, f);
+    send_to_js(x, &s_float, 1, &a);
 }
 
 /**
  * Handle symbol message
  */
 static void node_symbol(t_node *x, t_symbol *s) {
+    t_atom a;
+    SETSYMBOL(&a, s);
+    send_to_js(x, &s_symbol, 1, &a);
+}
+
+/**
+ * Handle list message
+ */
+static void node_list(t_node *x, t_symbol *s, int argc, t_atom *argv) {
+    send_to_js(x, &s_list, argc, argv);
+}
+
+/**
+ * Handle anything message (catch-all)
+ */
+static void node_anything(t_node *x, t_symbol *s, int argc, t_atom *argv) {
+    send_to_js(x, s, argc, argv);
+}
+
+/**
+ * Send a message arriving on the inlet to JavaScript
+ */
+static void send_to_js(t_node *x, t_symbol *selector, int argc, t_atom *argv) {
     if (!x->bridge || !x->ready) {
         return;
     }
+    double time = x->stamp_time ? clock_gettimesince(0) : 0;
     
-    json msg = {
-        {"type", "message"},
-        {"inlet", 0},
-        {"selector", "symbol"},
-        {"args", json::array({s->s_name})}
-    };
+    if (x->bridge->options().framing == Framing::BINARY) {
+        // Atoms go straight into a reused buffer, no JSON on the hot path
+        static std::string payload;
+        payload.clear();
+        AtomWriter writer(payload);
+        
+        if (selector == &s_bang) {
+            writer.add_tag(AtomTag::SEL_BANG);
+        } else if (selector == &s_float) {
+            writer.add_tag(AtomTag::SEL_FLOAT);
+        } else if (selector == &s_symbol) {
+            writer.add_tag(AtomTag::SEL_SYMBOL);
+        } else if (selector == &s_list) {
+            writer.add_tag(AtomTag::SEL_LIST);
+        } else {
+            writer.add_symbol(selector->s_name, strlen(selector->s_name));
+        }
+        
+        // Long all-float lists go as one packed block
+        bool packed = (size_t)argc >= kFloatArrayMin;
+        for (int i = 0; packed && i < argc; i++) {
+            packed = (argv[i].a_type == A_FLOAT);
+        }
+        
+        if (packed) {
+            writer.begin_float_array((uint32_t)argc);
+            for (int i = 0; i < argc; i++) {
+                writer.add_array_float(argv[i].a_w.w_float);
+            }
+        } else {
+            for (int i = 0; i < argc; i++) {
+                if (argv[i].a_type == A_FLOAT) {
+                    writer.add_float(atom_getfloat(&argv[i]));
+                } else if (argv[i].a_type == A_SYMBOL) {
+                    const char *name = atom_getsymbol(&argv[i])->s_name;
+                    writer.add_symbol(name, strlen(name));
+                }
+            }
+        }
+        
+        // Type and inlet travel in the frame header; the selector is the
+        // key under which queued messages may be coalesced
+        uint32_t seq = x->stats->sent();
+        x->stats->sent_bytes(payload.size());
+        x->bridge->send_message(payload, FrameType::MESSAGE, 0, (uintptr_t)selector, x->channel, time, seq);
+    } else {
+        // Debug/fallback: self-describing JSON
+        json args = json::array();
+        for (int i = 0; i < argc; i++) {
+            if (argv[i].a_type == A_FLOAT) {
+                args.push_back(atom_getfloat(&argv[i]));
+            } else if (argv[i].a_type == A_SYMBOL) {
+                args.push_back(atom_getsymbol(&argv[i])->s_name);
+            }
+        }
+        
+        json msg = {
+            {"type", "message"},
+            {"inlet", 0},
+            {"selector", selector->s_name},
+            {"args", args}
+        };
+        if (x->channel != 0) {
+            msg["channel"] = x->channel;
+        }
+        if (time != 0) {
+            msg["time"] = time;
+        }
+        uint32_t seq = x->stats->sent();
+        msg["seq"] = seq;
+        std::string line = msg.dump();
+        x->stats->sent_bytes(line.size());
+        x->bridge->send_message(line, FrameType::JSON, 0, (uintptr_t)selector, x->channel);
+    }
+    x->stats->queue_depth(x->bridge->pending_output());
     
-    x->bridge->send_message(msg.dump());
+    node_schedule_flush(x);
 }
 
 /**
- * Handle list message
+ * Coalesce everything sent during this scheduler tick into one write
  */
-static void node_list(t_node *x, t_symbol *s, int argc, t_atom *argv) {
-    if (!x->bridge || !x->ready) {
+static void node_schedule_flush(t_node *x) {
+    if (!x->flush_armed) {
+        x->flush_armed = true;
+        clock_delay(x->flush_clock, 0);
+    }
+}
+
+/**
+ * Pd's scheduler found data on the child's stdout
+ */
+static void node_stdout_ready(t_node *x, int fd) {
+    if (!x->bridge) {
+        return;
+    }
+    
+    // Read all available messages in one pass
+    node_receive(x);
+    
+    // stdout closes when the process goes away
+    if (x->bridge && x->bridge->at_eof()) {
+        if (x->bridge->exit_fd() >= 0 && !x->bridge->reap()) {
+            // Still exiting: node_exit_ready reports how it ended. A closed
+            // pipe stays readable forever, stop watching it
+            node_remove_fd(fd);
+            x->bridge->close_stdout();
+            return;
+        }
+        node_process_ended(x);
+    }
+}
+
+/**
+ * Pd's scheduler found data on the child's stderr
+ */
+static void node_stderr_ready(t_node *x, int fd) {
+    if (!x->bridge) {
         return;
     }
     
-    json args = json::array();
-    for (int i = 0; i < argc; i++) {
-        if (argv[i].a_type == A_FLOAT) {
-            args.push_back(atom_getfloat(&argv[i]));
-        } else if (argv[i].a_type == A_SYMBOL) {
-            args.push_back(atom_getsymbol(&argv[i])->s_name);
+    std::string text;
+    bool open = x->bridge->read_stderr(text);
+    node_post_stderr(x, text);
+    
+    // A closed pipe stays readable forever, stop watching it
+    if (!open) {
+        node_remove_fd(fd);
+    }
+}
+
+/**
+ * Read and handle every frame the child has written (on Pd's thread)
+ */
+static void node_receive(t_node *x) {
+    InboundMessage msg;
+    x->bridge->receive_messages([x, &msg](const FrameView& frame) {
+        if (!decode_inbound(frame, msg)) {
+            return;
+        }
+        // Switch transports before the next frame is read
+        if (msg.kind == InboundKind::READY && msg.channel == 0) {
+            x->bridge->settle_transport(msg.text);
+        }
+        handle_message(x, msg);
+    });
+}
+
+/**
+ * Print what a process wrote to stderr, one console line per line, as
+ * errors of `owner` (nullptr for a shared host) starting with `prefix`
+ */
+static void post_stderr_lines(const void *owner, const std::string& prefix, const std::string& text) {
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        if (end > start) {
+            pd_error(owner, "%s %.*s", prefix.c_str(), (int)(end - start), text.data() + start);
         }
+        start = end + 1;
+    }
+}
+
+/**
+ * Print what the child wrote to stderr
+ */
+static void node_post_stderr(t_node *x, const std::string& text) {
+    post_stderr_lines(x, "[node]", text);
+}
+
+/**
+ * The child process exited (its exit descriptor became readable)
+ */
+static void node_exit_ready(t_node *x, int fd) {
+    if (!x->bridge || !x->bridge->reap()) {
+        return;
     }
     
-    json msg = {
-        {"type", "message"},
-        {"inlet", 0},
-        {"selector", "list"},
-        {"args", args}
-    };
+    // Deliver whatever the script wrote before it went away
+    if (x->bridge->stdout_fd() >= 0) {
+        node_receive(x);
+    }
+    if (x->bridge && x->bridge->stderr_fd() >= 0) {
+        node_stderr_ready(x, x->bridge->stderr_fd());
+    }
+    if (x->bridge) {
+        node_process_ended(x);
+    }
+}
+
+/**
+ * Report the end of our process and let go of it
+ */
+static void node_process_ended(t_node *x) {
+    x->bridge->reap();
+    node_report_exit(x, *x->bridge);
+    node_close_bridge(x);
+}
+
+/**
+ * Tell the patch how the process ended: [exit <code>( or [signal <n>(
+ * out of the right outlet
+ */
+static void node_report_exit(t_node *x, const IPCBridge& bridge) {
+    if (!x->info_outlet) {
+        return;  // node_new() gave up before creating the outlets
+    }
+    t_atom a;
+    if (bridge.exit_signal() != 0) {
+        pd_error(x, "[node] Process terminated unexpectedly (signal %d)", bridge.exit_signal());
+        SETFLOAT(&a, bridge.exit_signal());
+        outlet_anything(x->info_outlet, gensym("signal"), 1, &a);
+    } else if (bridge.exit_code() >= 0) {
+        // A script may end on purpose (process.exit(0)): not an error
+        if (bridge.exit_code() != 0) {
+            pd_error(x, "[node] Process terminated unexpectedly (exit code %d)", bridge.exit_code());
+        } else {
+            post("[node] Process exited");
+        }
+        SETFLOAT(&a, bridge.exit_code());
+        outlet_anything(x->info_outlet, gensym("exit"), 1, &a);
+    } else {
+        // Not reaped yet (no exit descriptor on this platform)
+        pd_error(x, "[node] Process terminated unexpectedly");
+    }
+}
+
+/**
+ * Pd's scheduler found data from a shared host
+ */
+static void node_host_stdout_ready(SharedHost *host, int fd) {
+    host->receive_messages();
     
-    x->bridge->send_message(msg.dump());
+    // Every [node] in the host closes its channel, the last one destroys it
+    if (host->bridge().at_eof()) {
+        if (host->bridge().exit_fd() >= 0 && !host->bridge().reap()) {
+            // node_host_exit_ready takes it from here
+            node_remove_fd(fd);
+            host->bridge().close_stdout();
+            return;
+        }
+        node_host_ended(host);
+    }
 }
 
 /**
- * Handle anything message (catch-all)
+ * A shared host's process exited
  */
-static void node_anything(t_node *x, t_symbol *s, int argc, t_atom *argv) {
-    if (!x->bridge || !x->ready) {
+static void node_host_exit_ready(SharedHost *host, int fd) {
+    if (!host->bridge().reap()) {
         return;
     }
     
-    json args = json::array();
-    for (int i = 0; i < argc; i++) {
-        if (argv[i].a_type == A_FLOAT) {
-            args.push_back(atom_getfloat(&argv[i]));
-        } else if (argv[i].a_type == A_SYMBOL) {
-            args.push_back(atom_getsymbol(&argv[i])->s_name);
+    // Route its last words before the clients let go of it
+    if (host->bridge().stdout_fd() >= 0) {
+        host->receive_messages();
+    }
+    if (host->bridge().stderr_fd() >= 0) {
+        node_host_stderr_ready(host, host->bridge().stderr_fd());
+    }
+    node_host_ended(host);
+}
+
+/**
+ * Every [node] in the host reports the exit and closes its channel; the
+ * last one destroys the host
+ */
+static void node_host_ended(SharedHost *host) {
+    host->bridge().reap();
+    host->notify_exit();
+}
+
+/**
+ * Pd's scheduler found data on a shared host's stderr
+ */
+static void node_host_stderr_ready(SharedHost *host, int fd) {
+    std::string text;
+    bool open = host->bridge().read_stderr(text);
+    node_host_post_stderr(host, text);
+    
+    if (!open) {
+        node_remove_fd(fd);
+    }
+}
+
+/**
+ * Print what a shared host wrote to stderr
+ */
+static void node_host_post_stderr(SharedHost *host, const std::string& text) {
+    post_stderr_lines(nullptr, "[node " + host->name() + "]", text);
+}
+
+/**
+ * Watch a descriptor through the shared reactor, so Pd polls a single
+ * descriptor however many objects there are. Without one (no epoll or
+ * kqueue) Pd watches the descriptor itself.
+ */
+static void node_add_fd(int fd, t_fdpollfn fn, void *ptr) {
+    static bool polling = false;
+    Reactor& reactor = Reactor::instance();
+    if (reactor.add(fd, [fn, ptr](int ready) { fn(ptr, ready); })) {
+        if (!polling) {
+            sys_addpollfn(reactor.fd(), (t_fdpollfn)node_reactor_ready, nullptr);
+            polling = true;
         }
+        return;
+    }
+    sys_addpollfn(fd, fn, ptr);
+}
+
+/**
+ * Stop watching a descriptor added with node_add_fd()
+ */
+static void node_remove_fd(int fd) {
+    if (!Reactor::instance().remove(fd)) {
+        sys_rmpollfn(fd);
+    }
+}
+
+/**
+ * Some descriptor in the reactor is ready: run just its handler
+ */
+static void node_reactor_ready(void *unused, int fd) {
+    Reactor::instance().dispatch();
+}
+
+/**
+ * Register a bridge with the I/O thread, and its wakeup with Pd once
+ */
+static uint64_t node_watch_io(IPCBridge *bridge, const IOThread::Sink& sink) {
+    static bool polling = false;
+    IOThread& io = IOThread::instance();
+    if (!polling) {
+        node_add_fd(io.wake_fd(), (t_fdpollfn)node_io_ready, nullptr);
+        polling = true;
+    }
+    return io.watch(bridge, sink);
+}
+
+/**
+ * The I/O thread has decoded messages waiting: hand them all out
+ */
+static void node_io_ready(void *unused, int fd) {
+    IOThread::instance().drain();
+}
+
+/**
+ * A message the I/O thread read from our process
+ */
+static void node_io_message(t_node *x, InboundMessage& msg) {
+    if (!x->bridge) {
+        return;
     }
     
-    json msg = {
-        {"type", "message"},
-        {"inlet", 0},
-        {"selector", s->s_name},
-        {"args", args}
-    };
+    switch (msg.kind) {
+        case InboundKind::STDERR:
+            node_post_stderr(x, msg.text);
+            break;
+            
+        case InboundKind::CLOSED:
+            // With an exit descriptor, EXITED follows and reports the status
+            if (x->bridge->exit_fd() < 0 || x->bridge->reap()) {
+                node_process_ended(x);
+            }
+            break;
+            
+        case InboundKind::EXITED:
+            node_process_ended(x);
+            break;
+            
+        default:
+            handle_message(x, msg);
+            break;
+    }
+}
+
+/**
+ * A message the I/O thread read from a shared host
+ */
+static void node_host_io_message(SharedHost *host, InboundMessage& msg) {
+    switch (msg.kind) {
+        case InboundKind::STDERR:
+            node_host_post_stderr(host, msg.text);
+            break;
+            
+        case InboundKind::CLOSED:
+            if (host->bridge().exit_fd() < 0 || host->bridge().reap()) {
+                node_host_ended(host);
+            }
+            break;
+            
+        case InboundKind::EXITED:
+            node_host_ended(host);
+            break;
+            
+        default:
+            host->dispatch(msg);
+            break;
+    }
+}
+
+/**
+ * Write out the messages queued during this tick
+ */
+static void node_flush(t_node *x) {
+    x->flush_armed = false;
+    if (!x->bridge) {
+        return;
+    }
+    
+    // Script not keeping up: keep retrying until the JS side catches up
+    if (!x->bridge->flush_output()) {
+        x->flush_armed = true;
+        clock_delay(x->flush_clock, 1);
+    }
     
-    x->bridge->send_message(msg.dump());
+    uint64_t dropped = x->bridge->dropped_messages();
+    if (dropped != x->reported_drops) {
+        pd_error(x, "[node] script is not keeping up: %llu messages dropped",
+                 (unsigned long long)(dropped - x->reported_drops));
+        x->reported_drops = dropped;
+    }
 }
 
 /**
- * Poll for messages from JavaScript
+ * Stop watching the child's pipes and shut it down
  */
-static void node_poll(t_node *x) {
+static void node_close_bridge(t_node *x) {
     if (!x->bridge) {
         return;
     }
     
-    // Check if process is still running
-    if (!x->bridge->is_running()) {
-        pd_error(x, "[node] Process terminated unexpectedly");
-        delete x->bridge;
+    // In a shared host only our script goes away, unless we were the last
+    if (x->host) {
+        SharedHost *host = x->host;
+        x->host = nullptr;
         x->bridge = nullptr;
+        if (host->close_channel(x->channel)) {
+            if (host->io_watch()) {
+                IOThread::instance().unwatch(host->io_watch());
+                SharedHost::destroy(host);
+                return;
+            }
+            if (host->bridge().stdout_fd() >= 0) {
+                node_remove_fd(host->bridge().stdout_fd());
+            }
+            if (host->bridge().stderr_fd() >= 0) {
+                node_remove_fd(host->bridge().stderr_fd());
+            }
+            if (host->bridge().exit_fd() >= 0) {
+                node_remove_fd(host->bridge().exit_fd());
+            }
+            SharedHost::destroy(host);
+        }
         return;
     }
     
-    // Read all available messages
-    std::string msg;
-    while (x->bridge->try_receive_message(msg)) {
-        handle_json_message(x, msg);
+    if (x->io_watch) {
+        IOThread::instance().unwatch(x->io_watch);
+        x->io_watch = 0;
+    } else {
+        if (x->bridge->stdout_fd() >= 0) {
+            node_remove_fd(x->bridge->stdout_fd());
+        }
+        if (x->bridge->stderr_fd() >= 0) {
+            node_remove_fd(x->bridge->stderr_fd());
+        }
+        if (x->bridge->exit_fd() >= 0) {
+            node_remove_fd(x->bridge->exit_fd());
+        }
     }
     
-    // Schedule next poll
-    clock_delay(x->poll_clock, 1);
+    // The signal blocks are unmapped with the process
+    if (x->audio) {
+        x->audio->detach();
+    }
+    x->bridge->terminate();
+    delete x->bridge;
+    x->bridge = nullptr;
 }
 
 /**
- * Handle JSON message from JavaScript
+ * Handle a decoded message from JavaScript
  */
-static void handle_json_message(t_node *x, const std::string& json_str) {
-    try {
-        json msg = json::parse(json_str);
-        
-        std::string type = msg["type"];
-        
-        if (type == "ready") {
-            x->ready = true;
-            post("[node] JavaScript runtime ready");
+static void handle_message(t_node *x, const InboundMessage& msg) {
+    x->stats->received(msg.bytes, msg.parse_ns, msg.seq);
+    
+    switch (msg.kind) {
+        case InboundKind::OUTLET:
+            if (msg.time > clock_gettimesince(0)) {
+                schedule_outlet(x, msg);
+            } else {
+                emit_outlet(x, msg);
+            }
+            break;
             
-        } else if (type == "outlet") {
-            int outlet_num = msg["outlet"];
-            std::string selector = msg["selector"];
+        case InboundKind::READY:
+            handle_ready(x);
+            break;
             
-            if (selector == "bang") {
-                outlet_bang(x->outlet);
-                
-            } else if (selector == "float") {
-                t_float f = msg["args"][0];
-                outlet_float(x->outlet, f);
-                
-            } else if (selector == "symbol") {
-                std::string str = msg["args"][0];
-                outlet_symbol(x->outlet, gensym(str.c_str()));
-                
-            } else if (selector == "list") {
-                json args = msg["args"];
-                int argc = args.size();
-                t_atom argv[argc];
-                
-                for (int i = 0; i < argc; i++) {
-                    if (args[i].is_number()) {
-                        SETFLOAT(&argv[i], args[i]);
-                    } else if (args[i].is_string()) {
-                        std::string str = args[i];
-                        SETSYMBOL(&argv[i], gensym(str.c_str()));
-                    }
-                }
-                
-                outlet_list(x->outlet, &s_list, argc, argv);
-            }
+        case InboundKind::LOG:
+            post("[node] %s", msg.text.c_str());
+            break;
+            
+        case InboundKind::ERROR:
+        case InboundKind::INVALID:
+            pd_error(x, "[node] %s", msg.text.c_str());
+            break;
             
-        } else if (type == "log") {
-            std::string message = msg["message"];
-            post("[node] %s", message.c_str());
+        case InboundKind::ARRAY:
+            handle_array_written(x, msg.text);
+            break;
             
-        } else if (type == "error") {
-            std::string message = msg["message"];
-            pd_error(x, "[node] %s", message.c_str());
+        default:
+            break;
+    }
+}
+
+/**
+ * JavaScript runtime finished booting
+ */
+static void handle_ready(t_node *x) {
+    x->ready = true;
+    post("[node] JavaScript runtime ready");
+    
+    // Whoever read the 'ready' has already switched transports; a shared
+    // host does that once for everyone
+    if (!x->host && x->bridge->shared_memory_active()) {
+        post("[node] Using shared memory transport");
+    }
+    if (x->audio && !(x->audio->valid() && x->bridge->shared_memory_active())) {
+        pd_error(x, "[node~] Signal blocks need shared memory (Bun); outlets stay silent");
+    }
+    
+    // Anything sent before 'ready' was held back until now
+    if (x->bridge->has_pending_output()) {
+        node_schedule_flush(x);
+    }
+}
+
+/**
+ * Keep an outlet message the script stamped with a future logical time
+ * and fire it exactly then (pd.outletAt())
+ */
+static void schedule_outlet(t_node *x, const InboundMessage& msg) {
+    // Symbols it defines may be referenced by messages emitted before it
+    if (msg.selector.tag == AtomTag::SYMBOL_DEF) {
+        resolve_symbol(x, msg, msg.selector);
+    }
+    for (const InboundAtom& atom : msg.atoms) {
+        if (atom.tag == AtomTag::SYMBOL_DEF) {
+            resolve_symbol(x, msg, atom);
         }
-        
-    } catch (json::exception& e) {
-        pd_error(x, "[node] JSON parse error: %s", e.what());
+    }
+    
+    // Converted to systime once, so the clock fires exactly when it is due
+    double due = clock_getsystimeafter(msg.time - clock_gettimesince(0));
+    bool earliest = x->scheduled->empty() || due < x->scheduled->next_due();
+    x->scheduled->add(msg, due);
+    if (earliest) {
+        clock_set(x->schedule_clock, due);
+    }
+}
+
+/**
+ * The script wrote a shared array's mirror (pd.commit()): copy it back
+ * into the Pd array and report [written name( on the right outlet
+ */
+static void handle_array_written(t_node *x, const std::string& name) {
+    auto it = x->arrays->find(name);
+    if (it == x->arrays->end()) {
+        pd_error(x, "[node] Array '%s' is not shared", name.c_str());
+        return;
+    }
+    t_symbol *sym = gensym(name.c_str());
+    t_garray *array = (t_garray *)pd_findbyclass(sym, garray_class);
+    int length;
+    t_word *words;
+    if (!array || !garray_getfloatwords(array, &length, &words)) {
+        pd_error(x, "[node] No float array named '%s'", name.c_str());
+        return;
+    }
+    
+    // The Pd array may have been resized since it was shared
+    const float *data = (const float *)it->second.data();
+    int count = std::min(length, (int)(it->second.size() / sizeof(float)));
+    for (int i = 0; i < count; i++) {
+        words[i].w_float = data[i];
+    }
+    garray_redraw(array);
+    
+    if (x->info_outlet) {
+        t_atom a;
+        SETSYMBOL(&a, sym);
+        outlet_anything(x->info_outlet, gensym("written"), 1, &a);
+    }
+}
+
+/**
+ * Look up a symbol atom
+ * 
+ * Interned symbols go through gensym() once, when the script defines them;
+ * later references are a table lookup.
+ */
+static t_symbol *resolve_symbol(t_node *x, const InboundMessage& msg, const InboundAtom& atom) {
+    std::vector<t_symbol*>& table = *x->symbols;
+    switch (atom.tag) {
+        case AtomTag::SYMBOL_DEF: {
+            t_symbol *sym = gensym(msg.symbol(atom.offset));
+            if (atom.id >= table.size()) {
+                table.resize(atom.id + 1, nullptr);
+            }
+            table[atom.id] = sym;
+            return sym;
+        }
+        case AtomTag::SYMBOL_REF:
+            if (atom.id < table.size() && table[atom.id]) {
+                return table[atom.id];
+            }
+            pd_error(x, "[node] Unknown symbol id %d", atom.id);
+            return &s_;
+        default:
+            return gensym(msg.symbol(atom.offset));
+    }
+}
+
+/**
+ * Send a message from JavaScript out of the outlet
+ * 
+ * Only symbol lookup happens here, the atoms were decoded already. They
+ * are built in a pooled buffer, so this does not allocate once warmed up.
+ * A FLOAT_ARRAY block is filled in one loop straight from its floats.
+ */
+static void emit_outlet(t_node *x, const InboundMessage& msg) {
+    AtomPool<t_atom>::Lease atoms(*x->atom_pool, msg.argc);
+    t_atom *argv = atoms.data();
+    int argc = (int)atoms.size();
+    int i = 0;
+    for (const InboundAtom& atom : msg.atoms) {
+        if (atom.tag == AtomTag::FLOAT) {
+            SETFLOAT(&argv[i], atom.f);
+            i++;
+        } else if (atom.tag == AtomTag::FLOAT_ARRAY) {
+            const float *block = msg.floats.data() + atom.offset;
+            t_atom *out = argv + i;
+            for (uint32_t k = 0; k < atom.count; k++) {
+                out[k].a_type = A_FLOAT;
+                out[k].a_w.w_float = block[k];
+            }
+            i += (int)atom.count;
+        } else {
+            SETSYMBOL(&argv[i], resolve_symbol(x, msg, atom));
+            i++;
+        }
+    }
+    
+    switch (msg.selector.tag) {
+        case AtomTag::SEL_BANG:
+            outlet_bang(x->outlet);
+            break;
+        case AtomTag::SEL_FLOAT:
+            outlet_float(x->outlet, argc > 0 ? atom_getfloat(argv) : 0);
+            break;
+        case AtomTag::SEL_SYMBOL:
+            outlet_symbol(x->outlet, argc > 0 ? atom_getsymbol(argv) : &s_);
+            break;
+        case AtomTag::SEL_LIST:
+            outlet_list(x->outlet, &s_list, argc, argv);
+            break;
+        case AtomTag::SYMBOL:
+        case AtomTag::SYMBOL_DEF:
+        case AtomTag::SYMBOL_REF:
+            outlet_anything(x->outlet, resolve_symbol(x, msg, msg.selector), argc, argv);
+            break;
+        default:
+            pd_error(x, "[node] Malformed outlet message");
+            break;
     }
 }
@@ -0,0 +1,125 @@
+/**
+ * process_pool.cpp
+ * 
+ * Pool of pre-booted runtime processes waiting for a script
+ */
+
+#include "process_pool.h"
+#include "process_reaper.h"
+#include <cstdlib>
+#include <iostream>
+
+namespace pdnode {
+
+ProcessPool& ProcessPool::instance() {
+    static ProcessPool pool;
+    return pool;
+}
+
+ProcessPool::ProcessPool()
+    : size_(0)
+{
+    // Constructed first so it is destroyed last: our destructor still uses it
+    ProcessReaper::instance();
+    
+    const char* env = getenv("PD_NODE_POOL_SIZE");
+    if (env && *env) {
+        size_ = static_cast<size_t>(strtoul(env, nullptr, 10));
+    }
+}
+
+ProcessPool::~ProcessPool() {
+    clear();
+}
+
+std::string ProcessPool::slot_key(const std::string& runtime_path, const std::string& wrapper_path,
+                                  const BridgeOptions& options) {
+    // Only what is fixed at spawn time; queue settings are applied on acquire
+    return runtime_path + '\n' + wrapper_path + '\n'
+        + std::to_string(static_cast<int>(options.framing)) + ':'
+        + std::to_string(static_cast<int>(options.transport)) + ':'
+        + std::to_string(options.ring_capacity);
+}
+
+IPCBridge* ProcessPool::acquire(const std::string& runtime_path, const std::string& wrapper_path,
+                                const std::string& script_path, const BridgeOptions& options) {
+    if (size_ == 0) {
+        return nullptr;
+    }
+    
+    Slot& slot = slots_[slot_key(runtime_path, wrapper_path, options)];
+    if (slot.runtime_path.empty()) {
+        slot.runtime_path = runtime_path;
+        slot.wrapper_path = wrapper_path;
+        slot.options = options;
+    }
+    
+    while (!slot.idle.empty()) {
+        IPCBridge* bridge = slot.idle.back();
+        slot.idle.pop_back();
+        
+        // Idle processes may have died (killed, out of memory, ...)
+        if (!bridge->is_running()) {
+            delete bridge;
+            continue;
+        }
+        
+        bridge->set_queue_policy(options.overflow, options.queue_limit);
+        bridge->load_script(script_path);
+        return bridge;
+    }
+    return nullptr;
+}
+
+bool ProcessPool::refill_step() {
+    for (auto it = slots_.begin(); it != slots_.end(); ) {
+        Slot& slot = it->second;
+        if (slot.idle.size() >= size_) {
+            ++it;
+            continue;
+        }
+        
+        IPCBridge* bridge = new IPCBridge(slot.runtime_path, slot.wrapper_path, "", slot.options);
+        if (!bridge->spawn()) {
+            // Don't keep retrying a runtime that can't be started
+            std::cerr << "[node] Failed to spawn pooled process" << std::endl;
+            delete bridge;
+            for (IPCBridge* idle : slot.idle) {
+                delete idle;
+            }
+            it = slots_.erase(it);
+            continue;
+        }
+        slot.idle.push_back(bridge);
+        
+        for (const auto& entry : slots_) {
+            if (entry.second.idle.size() < size_) {
+                return true;
+            }
+        }
+        return false;
+    }
+    return false;
+}
+
+void ProcessPool::set_size(size_t size) {
+    size_ = size;
+    for (auto& entry : slots_) {
+        std::vector<IPCBridge*>& idle = entry.second.idle;
+        while (idle.size() > size_) {
+            delete idle.back();
+            idle.pop_back();
+        }
+    }
+}
+
+void ProcessPool::clear() {
+    for (auto& entry : slots_) {
+        for (IPCBridge* bridge : entry.second.idle) {
+            delete bridge;
+        }
+        entry.second.idle.clear();
+    }
+}
+
+} // namespace pdnode
@@ -0,0 +1,78 @@
+/**
+ * process_pool.h
+ * 
+ * Pool of pre-booted runtime processes waiting for a script
+ */
+
+#ifndef PD_NODE_PROCESS_POOL_H
+#define PD_NODE_PROCESS_POOL_H
+
+#include "ipc_bridge.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace pdnode {
+
+/**
+ * Process Pool - keeps idle wrapper.js processes per runtime/options so a
+ * new [node] only has to load its script instead of booting a runtime
+ * 
+ * Not thread-safe: only used from Pd's main thread.
+ */
+class ProcessPool {
+public:
+    /**
+     * Process-wide pool; size from PD_NODE_POOL_SIZE (default 0: off)
+     */
+    static ProcessPool& instance();
+    
+    /**
+     * Take an idle process for this runtime/options and load the script
+     * Also remembers the combination so refill() keeps it warm.
+     * 
+     * @return Spawned bridge (caller owns it), or nullptr if none is idle
+     */
+    IPCBridge* acquire(const std::string& runtime_path, const std::string& wrapper_path,
+                       const std::string& script_path, const BridgeOptions& options);
+    
+    /**
+     * Spawn at most one idle process, so refilling never stalls Pd for long
+     * Returns true if more processes are still missing
+     */
+    bool refill_step();
+    
+    /**
+     * Number of idle processes kept per runtime/options (0 disables)
+     */
+    void set_size(size_t size);
+    size_t size() const { return size_; }
+    
+    /**
+     * Terminate all idle processes
+     */
+    void clear();
+    
+private:
+    ProcessPool();
+    ~ProcessPool();
+    ProcessPool(const ProcessPool&) = delete;
+    ProcessPool& operator=(const ProcessPool&) = delete;
+    
+    // Processes are interchangeable if they were spawned the same way
+    struct Slot {
+        std::string runtime_path;
+        std::string wrapper_path;
+        BridgeOptions options;
+        std::vector<IPCBridge*> idle;
+    };
+    static std::string slot_key(const std::string& runtime_path, const std::string& wrapper_path,
+                                const BridgeOptions& options);
+    
+    std::map<std::string, Slot> slots_;
+    size_t size_;
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_PROCESS_POOL_H
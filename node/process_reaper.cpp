@@ -0,0 +1,187 @@
+/**
+ * process_reaper.cpp
+ * 
+ * Background reaping of terminated runtime processes
+ */
+
+#include "process_reaper.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace pdnode {
+
+// Upper bound on a poll when there is no pidfd to wait on
+static const int kPollIntervalMs = 10;
+
+// Descriptor that becomes readable when `pid` exits, or -1
+static int open_pidfd(pid_t pid) {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    int fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+    if (fd >= 0) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+ProcessReaper& ProcessReaper::instance() {
+    static ProcessReaper reaper;
+    return reaper;
+}
+
+ProcessReaper::ProcessReaper()
+    : stopping_(false)
+{
+    if (pipe(wake_pipe_) == 0) {
+        for (int fd : wake_pipe_) {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        }
+    } else {
+        wake_pipe_[0] = wake_pipe_[1] = -1;
+    }
+}
+
+ProcessReaper::~ProcessReaper() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    idle_.notify_one();
+    wake();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    
+    // Pd is exiting: don't wait for stragglers, just make sure they die
+    for (Child& child : children_) {
+        kill(child.pid, SIGKILL);
+        if (child.pidfd >= 0) {
+            close(child.pidfd);
+        }
+    }
+    for (int fd : wake_pipe_) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void ProcessReaper::terminate(pid_t pid, std::chrono::milliseconds grace) {
+    if (pid <= 0) {
+        return;
+    }
+    
+    // Open the pidfd before signalling, while the pid surely is our child
+    int pidfd = open_pidfd(pid);
+    kill(pid, SIGTERM);
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        children_.push_back({ pid, pidfd, std::chrono::steady_clock::now() + grace, false });
+        if (!thread_.joinable()) {
+            thread_ = std::thread(&ProcessReaper::run, this);
+        }
+    }
+    idle_.notify_one();
+    wake();
+}
+
+size_t ProcessReaper::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return children_.size();
+}
+
+void ProcessReaper::wake() {
+    if (wake_pipe_[1] >= 0) {
+        const char byte = 0;
+        (void)!write(wake_pipe_[1], &byte, 1);
+    }
+}
+
+bool ProcessReaper::try_reap(Child& child) {
+    pid_t result = waitpid(child.pid, nullptr, WNOHANG);
+    
+    // ECHILD: someone else reaped it already
+    return result == child.pid || (result < 0 && errno == ECHILD);
+}
+
+void ProcessReaper::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    while (!stopping_) {
+        if (children_.empty()) {
+            idle_.wait(lock, [this] { return stopping_ || !children_.empty(); });
+            continue;
+        }
+        
+        // Reap whoever exited, escalate for whoever overstayed
+        auto now = std::chrono::steady_clock::now();
+        auto next_deadline = std::chrono::steady_clock::time_point::max();
+        bool all_pidfds = true;
+        std::vector<struct pollfd> fds;
+        for (size_t i = 0; i < children_.size(); ) {
+            Child& child = children_[i];
+            if (try_reap(child)) {
+                if (child.pidfd >= 0) {
+                    close(child.pidfd);
+                }
+                children_[i] = children_.back();
+                children_.pop_back();
+                continue;
+            }
+            if (!child.killed && now >= child.deadline) {
+                kill(child.pid, SIGKILL);
+                child.killed = true;
+            }
+            if (!child.killed && child.deadline < next_deadline) {
+                next_deadline = child.deadline;
+            }
+            if (child.pidfd >= 0) {
+                fds.push_back({ child.pidfd, POLLIN, 0 });
+            } else {
+                all_pidfds = false;
+            }
+            i++;
+        }
+        if (children_.empty()) {
+            continue;
+        }
+        
+        // Sleep until a child exits, a deadline passes or new work arrives
+        int timeout = -1;
+        if (next_deadline != std::chrono::steady_clock::time_point::max()) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(next_deadline - now).count() + 1;
+            timeout = static_cast<int>(left);
+        }
+        if (!all_pidfds && (timeout < 0 || timeout > kPollIntervalMs)) {
+            timeout = kPollIntervalMs;
+        }
+        if (wake_pipe_[0] >= 0) {
+            fds.push_back({ wake_pipe_[0], POLLIN, 0 });
+        } else if (timeout < 0 || timeout > kPollIntervalMs) {
+            timeout = kPollIntervalMs;
+        }
+        
+        lock.unlock();
+        poll(fds.data(), fds.size(), timeout);
+        if (wake_pipe_[0] >= 0) {
+            char buffer[64];
+            while (read(wake_pipe_[0], buffer, sizeof(buffer)) > 0) {
+            }
+        }
+        lock.lock();
+    }
+}
+
+} // namespace pdnode
@@ -0,0 +1,70 @@
+/**
+ * process_reaper.h
+ * 
+ * Background reaping of terminated runtime processes
+ */
+
+#ifndef PD_NODE_PROCESS_REAPER_H
+#define PD_NODE_PROCESS_REAPER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+namespace pdnode {
+
+/**
+ * Process Reaper - lets Pd's main thread hand off a child it wants gone
+ * 
+ * terminate() sends SIGTERM and returns immediately. A background thread
+ * waits for the child to exit (pidfd on Linux, polling elsewhere), reaps
+ * it, and escalates to SIGKILL if it is still alive after the grace period.
+ */
+class ProcessReaper {
+public:
+    /**
+     * Process-wide reaper; its thread starts on first use
+     */
+    static ProcessReaper& instance();
+    
+    /**
+     * Ask `pid` to exit and reap it in the background
+     */
+    void terminate(pid_t pid, std::chrono::milliseconds grace = std::chrono::milliseconds(1000));
+    
+    /**
+     * Number of children not reaped yet
+     */
+    size_t pending() const;
+    
+private:
+    ProcessReaper();
+    ~ProcessReaper();
+    ProcessReaper(const ProcessReaper&) = delete;
+    ProcessReaper& operator=(const ProcessReaper&) = delete;
+    
+    struct Child {
+        pid_t pid;
+        int pidfd;   // -1 if unavailable
+        std::chrono::steady_clock::time_point deadline;
+        bool killed;
+    };
+    
+    void run();
+    void wake();
+    bool try_reap(Child& child);
+    
+    mutable std::mutex mutex_;
+    std::condition_variable idle_;
+    std::vector<Child> children_;
+    std::thread thread_;
+    int wake_pipe_[2];
+    bool stopping_;
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_PROCESS_REAPER_H
@@ -0,0 +1,129 @@
+/**
+ * reactor.cpp
+ * 
+ * One readiness descriptor for the pipes of every [node]
+ */
+
+#include "reactor.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#elif defined(__APPLE__)
+#include <sys/event.h>
+#endif
+
+namespace pdnode {
+
+// Events fetched per system call
+static const int kMaxEvents = 64;
+
+Reactor& Reactor::instance() {
+    static Reactor reactor;
+    return reactor;
+}
+
+Reactor::Reactor()
+    : fd_(-1)
+    , next_id_(1)
+{
+#if defined(__linux__)
+    fd_ = epoll_create1(EPOLL_CLOEXEC);
+#elif defined(__APPLE__)
+    fd_ = kqueue();
+    if (fd_ >= 0) {
+        fcntl(fd_, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+}
+
+Reactor::~Reactor() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool Reactor::add(int fd, const Handler& handler) {
+    if (fd_ < 0 || fd < 0) {
+        return false;
+    }
+    
+    uint64_t id = next_id_++;
+#if defined(__linux__)
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    if (epoll_ctl(fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+        return false;
+    }
+#elif defined(__APPLE__)
+    struct kevent change;
+    EV_SET(&change, fd, EVFILT_READ, EV_ADD, 0, 0, reinterpret_cast<void*>(static_cast<uintptr_t>(id)));
+    if (kevent(fd_, &change, 1, nullptr, 0, nullptr) < 0) {
+        return false;
+    }
+#endif
+
+    entries_[id] = { fd, handler };
+    ids_[fd] = id;
+    return true;
+}
+
+bool Reactor::remove(int fd) {
+    auto it = ids_.find(fd);
+    if (it == ids_.end()) {
+        return false;
+    }
+    entries_.erase(it->second);
+    ids_.erase(it);
+    
+    // Fails harmlessly if the descriptor was already closed (that removed it)
+#if defined(__linux__)
+    epoll_ctl(fd_, EPOLL_CTL_DEL, fd, nullptr);
+#elif defined(__APPLE__)
+    struct kevent change;
+    EV_SET(&change, fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    kevent(fd_, &change, 1, nullptr, 0, nullptr);
+#endif
+    return true;
+}
+
+size_t Reactor::dispatch() {
+    if (fd_ < 0) {
+        return 0;
+    }
+    
+    // One batch per call: anything left over keeps our descriptor readable
+    uint64_t ready[kMaxEvents];
+    int n = 0;
+#if defined(__linux__)
+    struct epoll_event events[kMaxEvents];
+    n = epoll_wait(fd_, events, kMaxEvents, 0);
+    for (int i = 0; i < n; i++) {
+        ready[i] = events[i].data.u64;
+    }
+#elif defined(__APPLE__)
+    struct kevent events[kMaxEvents];
+    struct timespec zero = { 0, 0 };
+    n = kevent(fd_, nullptr, 0, events, kMaxEvents, &zero);
+    for (int i = 0; i < n; i++) {
+        ready[i] = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(events[i].udata));
+    }
+#endif
+
+    size_t count = 0;
+    for (int i = 0; i < n; i++) {
+        // Earlier handlers may have removed this one
+        auto it = entries_.find(ready[i]);
+        if (it == entries_.end()) {
+            continue;
+        }
+        Entry entry = it->second;
+        entry.handler(entry.fd);
+        count++;
+    }
+    return count;
+}
+
+} // namespace pdnode
@@ -0,0 +1,81 @@
+/**
+ * reactor.h
+ * 
+ * One readiness descriptor for the pipes of every [node]
+ */
+
+#ifndef PD_NODE_REACTOR_H
+#define PD_NODE_REACTOR_H
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+namespace pdnode {
+
+/**
+ * Reactor - multiplexes many descriptors behind a single one
+ * 
+ * Descriptors are added to an epoll set (Linux) or kqueue (macOS) whose
+ * own descriptor becomes readable when any of them is. Pd then watches
+ * just that one, and dispatch() only visits descriptors that are ready,
+ * so the cost follows traffic rather than the number of objects.
+ * 
+ * Level-triggered, like Pd's own polling. Not thread-safe: only used
+ * from Pd's main thread.
+ */
+class Reactor {
+public:
+    using Handler = std::function<void(int fd)>;
+    
+    /**
+     * Process-wide reactor
+     */
+    static Reactor& instance();
+    
+    /**
+     * Descriptor to watch for readability, or -1 if the platform has no
+     * readiness API (add() then always fails)
+     */
+    int fd() const { return fd_; }
+    
+    /**
+     * Call `handler` whenever `fd` is readable
+     * Returns false if the reactor is unavailable.
+     */
+    bool add(int fd, const Handler& handler);
+    
+    /**
+     * Stop watching `fd` (before closing it)
+     * Returns false if it was not added.
+     */
+    bool remove(int fd);
+    
+    /**
+     * Call the handlers of all ready descriptors. Never blocks.
+     * Returns the number of handlers called.
+     */
+    size_t dispatch();
+
+private:
+    Reactor();
+    ~Reactor();
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+    
+    struct Entry {
+        int fd;
+        Handler handler;
+    };
+    
+    int fd_;
+    uint64_t next_id_;
+    // Events carry an id, not the fd: a handler may close a descriptor that
+    // is reopened with the same number before its stale event is seen
+    std::unordered_map<uint64_t, Entry> entries_;
+    std::unordered_map<int, uint64_t> ids_;
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_REACTOR_H
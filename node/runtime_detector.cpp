@@ -6,21 +6,36 @@
  */
 
 #include "runtime_detector.h"
+#include "json.hpp"
 #include <cstdlib>
 #include <cstring>
 #include <array>
+#include <cstdio>
+#include <fstream>
 #include <sstream>
+#include <sys/stat.h>
 
 #ifdef _WIN32
 #include <windows.h>
+#include <direct.h>
 #define popen _popen
 #define pclose _pclose
 #else
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
 #include <unistd.h>
+
+extern char** environ;
 #endif
 
 namespace pdnode {
 
+using json = nlohmann::json;
+
+#ifdef _WIN32
 // Execute command and capture output
 static std::string exec_command(const char* cmd) {
     std::array<char, 128> buffer;
@@ -44,40 +59,329 @@ static std::string exec_command(const char* cmd) {
     
     return result;
 }
+#endif
+
+// Resolve a command to an executable path, empty if not found
+static std::string find_in_path(const char* cmd) {
+#ifdef _WIN32
+    std::string found = exec_command((std::string("where ") + cmd + " 2>nul").c_str());
+    size_t eol = found.find_first_of("\r\n");
+    return (eol == std::string::npos) ? found : found.substr(0, eol);
+#else
+    // Walk $PATH in-process, like `which`, without spawning a shell
+    const char* path = getenv("PATH");
+    if (!path) {
+        path = "/usr/local/bin:/usr/bin:/bin";
+    }
+    
+    std::string dirs(path);
+    size_t start = 0;
+    while (start <= dirs.size()) {
+        size_t end = dirs.find(':', start);
+        if (end == std::string::npos) {
+            end = dirs.size();
+        }
+        
+        // An empty entry means the current directory
+        std::string dir = (end > start) ? dirs.substr(start, end - start) : ".";
+        std::string candidate = dir + "/" + cmd;
+        
+        struct stat st;
+        if (stat(candidate.c_str(), &st) == 0 && S_ISREG(st.st_mode)
+            && access(candidate.c_str(), X_OK) == 0) {
+            return candidate;
+        }
+        start = end + 1;
+    }
+    return "";
+#endif
+}
 
-// Check if command exists in PATH
-static bool command_exists(const char* cmd) {
+// Run `<binary> --version` directly and return the first line of output
+static std::string read_version(const std::string& binary) {
 #ifdef _WIN32
-    std::string check = std::string("where ") + cmd + " >nul 2>&1";
+    return exec_command(("\"" + binary + "\" --version").c_str());
+#else
+    int fds[2];
+#ifdef __linux__
+    if (pipe2(fds, O_CLOEXEC) < 0) {
+        return "";
+    }
 #else
-    std::string check = std::string("which ") + cmd + " >/dev/null 2>&1";
+    // No pipe2 (macOS): nothing else forks while runtimes are detected
+    if (pipe(fds) < 0) {
+        return "";
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
 #endif
     
-    return system(check.c_str()) == 0;
+    // Like IPCBridge::spawn(): no fork, so Pd's address space isn't copied,
+    // and the child gets only the pipe on stdout
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+    posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1);
+#endif
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attr, &signals);
+    sigaddset(&signals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &signals);
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_CLOEXEC_DEFAULT
+    flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+#endif
+    posix_spawnattr_setflags(&attr, flags);
+    
+    char* const argv[] = {
+        const_cast<char*>(binary.c_str()),
+        const_cast<char*>("--version"),
+        nullptr
+    };
+    pid_t pid;
+    int err = posix_spawn(&pid, binary.c_str(), &actions, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(fds[1]);
+    if (err != 0) {
+        close(fds[0]);
+        return "";
+    }
+    
+    std::string result;
+    char buffer[128];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        result.append(buffer, n);
+    }
+    close(fds[0]);
+    
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    
+    size_t eol = result.find_first_of("\r\n");
+    return (eol == std::string::npos) ? result : result.substr(0, eol);
+#endif
+}
+
+// Location of the version cache: $XDG_CACHE_HOME/pd-node/runtimes.json
+static std::string version_cache_path() {
+    std::string dir;
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    if (xdg && xdg[0] == '/') {
+        dir = xdg;
+    } else if (home && home[0]) {
+#ifdef __APPLE__
+        dir = std::string(home) + "/Library/Caches";
+#else
+        dir = std::string(home) + "/.cache";
+#endif
+    } else {
+        return "";
+    }
+    return dir + "/pd-node/runtimes.json";
+}
+
+// Create the parent directories of `file`
+static void make_parent_dirs(const std::string& file) {
+    for (size_t pos = file.find('/', 1); pos != std::string::npos; pos = file.find('/', pos + 1)) {
+#ifdef _WIN32
+        _mkdir(file.substr(0, pos).c_str());
+#else
+        mkdir(file.substr(0, pos).c_str(), 0755);
+#endif
+    }
+}
+
+RuntimeDetector& RuntimeDetector::instance() {
+    // Function-local static: initialized once, thread-safe since C++11
+    static RuntimeDetector detector;
+    return detector;
 }
 
 RuntimeDetector::RuntimeDetector() {
     detect_runtimes();
 }
 
+void RuntimeDetector::rescan() {
+    detect_runtimes();
+}
+
 void RuntimeDetector::detect_runtimes() {
-    // Check for Bun
-    if (command_exists("bun")) {
-        bun_available_ = true;
-        bun_path_ = exec_command("which bun");
-        bun_version_ = exec_command("bun --version");
+    // Only resolve paths here; versions cost a fork and are read on demand.
+#ifdef PD_NODE_BENCH
+    // Benchmark builds only: PD_NODE_RUNTIME names the echo runtime to use
+    // instead of Bun
+    const char* forced = getenv("PD_NODE_RUNTIME");
+    std::string bun_path = (forced && *forced) ? std::string(forced) : find_in_path("bun");
+#else
+    std::string bun_path = find_in_path("bun");
+#endif
+    std::string node_path = find_in_path("node");
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    bun_available_ = !bun_path.empty();
+    node_available_ = !node_path.empty();
+    bun_path_ = bun_path;
+    node_path_ = node_path;
+    bun_version_.clear();
+    node_version_.clear();
+    bun_version_read_ = false;
+    node_version_read_ = false;
+    version_cache_loaded_ = false;  // Pick up changes made by other Pd instances
+}
+
+const std::string& RuntimeDetector::version_locked(Runtime runtime) const {
+    static const std::string none;
+    switch (runtime) {
+        case Runtime::BUN:
+            if (!bun_version_read_ && bun_available_) {
+                bun_version_ = cached_version(bun_path_);
+                bun_version_read_ = true;
+            }
+            return bun_version_;
+        case Runtime::NODE:
+            if (!node_version_read_ && node_available_) {
+                node_version_ = cached_version(node_path_);
+                node_version_read_ = true;
+            }
+            return node_version_;
+        default:
+            return none;
+    }
+}
+
+bool RuntimeDetector::is_bun_available() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bun_available_;
+}
+
+bool RuntimeDetector::is_node_available() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return node_available_;
+}
+
+bool RuntimeDetector::has_any_runtime() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bun_available_ || node_available_;
+}
+
+std::string RuntimeDetector::cached_version(const std::string& binary) const {
+    struct stat st;
+    if (stat(binary.c_str(), &st) != 0) {
+        return "";
     }
     
-    // Check for Node.js
-    if (command_exists("node")) {
-        node_available_ = true;
-        node_path_ = exec_command("which node");
-        node_version_ = exec_command("node --version");
+    load_version_cache();
+    
+    // Same inode, mtime and size: assume the same binary
+    auto it = version_cache_.find(binary);
+    if (it != version_cache_.end()
+        && it->second.inode == (uint64_t)st.st_ino
+        && it->second.mtime == (int64_t)st.st_mtime
+        && it->second.size == (uint64_t)st.st_size) {
+        return it->second.version;
+    }
+    
+    std::string version = read_version(binary);
+    if (!version.empty()) {
+        version_cache_[binary] = { version, (uint64_t)st.st_ino, (int64_t)st.st_mtime, (uint64_t)st.st_size };
+        save_version_cache();
     }
+    return version;
+}
+
+void RuntimeDetector::load_version_cache() const {
+    if (version_cache_loaded_) {
+        return;
+    }
+    version_cache_loaded_ = true;
+    version_cache_.clear();
+    
+    std::string path = version_cache_path();
+    std::ifstream in(path);
+    if (path.empty() || !in) {
+        return;
+    }
+    
+    // A corrupt cache is simply ignored and rewritten later
+    json cache = json::parse(in, nullptr, false);
+    if (!cache.is_object()) {
+        return;
+    }
+    
+    // Entries of the wrong shape are skipped: get<>() would throw
+    for (auto& [binary, entry] : cache.items()) {
+        if (!entry.is_object()) {
+            continue;
+        }
+        auto version = entry.find("version");
+        auto inode = entry.find("inode");
+        auto mtime = entry.find("mtime");
+        auto size = entry.find("size");
+        if (version == entry.end() || !version->is_string()
+            || inode == entry.end() || !inode->is_number_unsigned()
+            || mtime == entry.end() || !mtime->is_number_integer()
+            || size == entry.end() || !size->is_number_unsigned()) {
+            continue;
+        }
+        version_cache_[binary] = {
+            version->get<std::string>(),
+            inode->get<uint64_t>(),
+            mtime->get<int64_t>(),
+            size->get<uint64_t>()
+        };
+    }
+}
+
+void RuntimeDetector::save_version_cache() const {
+    std::string path = version_cache_path();
+    if (path.empty()) {
+        return;
+    }
+    
+    json cache = json::object();
+    for (const auto& [binary, entry] : version_cache_) {
+        cache[binary] = {
+            {"version", entry.version},
+            {"inode", entry.inode},
+            {"mtime", entry.mtime},
+            {"size", entry.size}
+        };
+    }
+    
+    // Write to a temporary file and rename, so readers never see half a file
+    make_parent_dirs(path);
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        out << cache.dump(2) << "\n";
+        if (!out) {
+            return;
+        }
+    }
+    std::rename(tmp.c_str(), path.c_str());
 }
 
 Runtime RuntimeDetector::get_runtime_for_script(const std::string& script_path) const {
     ScriptType type = detect_script_type(script_path);
+    std::lock_guard<std::mutex> lock(mutex_);
     
     // TypeScript REQUIRES Bun (for now)
     if (type == ScriptType::TYPESCRIPT) {
@@ -113,6 +417,7 @@ ScriptType RuntimeDetector::detect_script_type(const std::string& path) const {
 }
 
 std::string RuntimeDetector::get_runtime_path(Runtime runtime) const {
+    std::lock_guard<std::mutex> lock(mutex_);
     switch (runtime) {
         case Runtime::BUN:
             return bun_path_;
@@ -124,14 +429,8 @@ std::string RuntimeDetector::get_runtime_path(Runtime runtime) const {
 }
 
 std::string RuntimeDetector::get_runtime_version(Runtime runtime) const {
-    switch (runtime) {
-        case Runtime::BUN:
-            return bun_version_;
-        case Runtime::NODE:
-            return node_version_;
-        default:
-            return "";
-    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return version_locked(runtime);
 }
 
 std::string RuntimeDetector::get_runtime_name(Runtime runtime) const {
@@ -170,18 +469,19 @@ std::string RuntimeDetector::get_error_message(const std::string& script_path) c
 }
 
 std::string RuntimeDetector::get_info_string() const {
+    std::lock_guard<std::mutex> lock(mutex_);
     std::ostringstream oss;
     
     oss << "pd-node runtime detection:\n";
     
     if (bun_available_) {
-        oss << "  Bun: " << bun_version_ << " (" << bun_path_ << ")\n";
+        oss << "  Bun: " << version_locked(Runtime::BUN) << " (" << bun_path_ << ")\n";
     } else {
         oss << "  Bun: not found\n";
     }
     
     if (node_available_) {
-        oss << "  Node.js: " << node_version_ << " (" << node_path_ << ")\n";
+        oss << "  Node.js: " << version_locked(Runtime::NODE) << " (" << node_path_ << ")\n";
     } else {
         oss << "  Node.js: not found\n";
     }
@@ -7,6 +7,9 @@
 #ifndef PD_NODE_RUNTIME_DETECTOR_H
 #define PD_NODE_RUNTIME_DETECTOR_H
 
+#include <cstdint>
+#include <map>
+#include <mutex>
 #include <string>
 
 namespace pdnode {
@@ -30,10 +33,21 @@ enum class ScriptType {
 
 /**
  * Runtime detector and selector
+ * 
+ * Detection is expensive (it forks), so there is one detector per Pd
+ * process, created lazily on first use and refreshed only on request.
  */
 class RuntimeDetector {
 public:
-    RuntimeDetector();
+    /**
+     * Process-wide detector, detecting runtimes on first call
+     */
+    static RuntimeDetector& instance();
+    
+    /**
+     * Detect runtimes again (e.g. after installing Bun while Pd runs)
+     */
+    void rescan();
     
     /**
      * Get appropriate runtime for a script
@@ -46,9 +60,9 @@ public:
     /**
      * Check if a specific runtime is available
      */
-    bool is_bun_available() const { return bun_available_; }
-    bool is_node_available() const { return node_available_; }
-    bool has_any_runtime() const { return bun_available_ || node_available_; }
+    bool is_bun_available() const;
+    bool is_node_available() const;
+    bool has_any_runtime() const;
     
     /**
      * Get runtime executable path
@@ -56,7 +70,8 @@ public:
     std::string get_runtime_path(Runtime runtime) const;
     
     /**
-     * Get runtime version string
+     * Get runtime version string: from the on-disk cache while the binary
+     * is unchanged, else runs `<runtime> --version` (once per Pd process)
      */
     std::string get_runtime_version(Runtime runtime) const;
     
@@ -76,16 +91,42 @@ public:
     std::string get_info_string() const;
     
 private:
+    RuntimeDetector();
+    RuntimeDetector(const RuntimeDetector&) = delete;
+    RuntimeDetector& operator=(const RuntimeDetector&) = delete;
+    
     void detect_runtimes();
+    const std::string& version_locked(Runtime runtime) const;  // Caller holds mutex_
+    std::string cached_version(const std::string& binary) const;
+    void load_version_cache() const;
+    void save_version_cache() const;
     ScriptType detect_script_type(const std::string& path) const;
     
+    mutable std::mutex mutex_;  // Guards the fields below
+    
     bool bun_available_ = false;
     bool node_available_ = false;
     
     std::string bun_path_;
-    std::string bun_version_;
     std::string node_path_;
-    std::string node_version_;
+    
+    // Read lazily on first request, then cached until rescan()
+    mutable std::string bun_version_;
+    mutable std::string node_version_;
+    mutable bool bun_version_read_ = false;
+    mutable bool node_version_read_ = false;
+    
+    /**
+     * On-disk version cache entry, valid while the binary is unchanged
+     */
+    struct CachedVersion {
+        std::string version;
+        uint64_t inode;
+        int64_t mtime;
+        uint64_t size;
+    };
+    mutable std::map<std::string, CachedVersion> version_cache_;  // By binary path
+    mutable bool version_cache_loaded_ = false;
 };
 
 } // namespace pdnode
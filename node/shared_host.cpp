@@ -0,0 +1,131 @@
+/**
+ * shared_host.cpp
+ * 
+ * One JS process serving many [node] objects, one channel per script
+ */
+
+#include "shared_host.h"
+#include <vector>
+
+namespace pdnode {
+
+std::map<std::string, SharedHost*>& SharedHost::registry() {
+    static std::map<std::string, SharedHost*> hosts;
+    return hosts;
+}
+
+SharedHost* SharedHost::acquire(const std::string& name, const std::string& runtime_path,
+                                const std::string& wrapper_path, const BridgeOptions& options, bool& created) {
+    created = false;
+    
+    // Same name but a different runtime or transport gets its own process
+    std::string key = name + '\n' + runtime_path + '\n' + wrapper_path + '\n'
+        + std::to_string(static_cast<int>(options.framing)) + ':'
+        + std::to_string(static_cast<int>(options.transport)) + ':'
+        + std::to_string(options.ring_capacity);
+    
+    auto it = registry().find(key);
+    if (it != registry().end()) {
+        return it->second;
+    }
+    
+    // Spawned without a script: scripts arrive as LOAD frames
+    SharedHost* host = new SharedHost(name, key, runtime_path, wrapper_path, options);
+    if (!host->bridge_.spawn()) {
+        delete host;
+        return nullptr;
+    }
+    registry()[key] = host;
+    created = true;
+    return host;
+}
+
+void SharedHost::destroy(SharedHost* host) {
+    registry().erase(host->key_);
+    delete host;
+}
+
+SharedHost::SharedHost(const std::string& name, const std::string& key, const std::string& runtime_path,
+                       const std::string& wrapper_path, const BridgeOptions& options)
+    : name_(name)
+    , key_(key)
+    , bridge_(runtime_path, wrapper_path, "", options)
+    , next_channel_(1)
+    , ready_(false)
+    , io_watch_(0)
+{
+}
+
+SharedHost::~SharedHost() {
+    bridge_.terminate();
+}
+
+uint32_t SharedHost::open_channel(const std::string& script_path, const HostClient& client) {
+    uint32_t channel = next_channel_++;
+    if (next_channel_ == 0) {
+        next_channel_ = 1;
+    }
+    clients_[channel] = client;
+    bridge_.load_script(script_path, channel);
+    return channel;
+}
+
+bool SharedHost::close_channel(uint32_t channel) {
+    clients_.erase(channel);
+    if (clients_.empty()) {
+        return true;
+    }
+    
+    // The others keep running; write the unload right away
+    bridge_.unload_script(channel);
+    bridge_.flush_output();
+    return false;
+}
+
+size_t SharedHost::receive_messages() {
+    InboundMessage msg;
+    return bridge_.receive_messages([this, &msg](const FrameView& frame) {
+        if (!decode_inbound(frame, msg)) {
+            return;
+        }
+        if (msg.kind == InboundKind::READY && msg.channel == 0) {
+            bridge_.settle_transport(msg.text);
+        }
+        dispatch(msg);
+    });
+}
+
+void SharedHost::dispatch(const InboundMessage& msg) {
+    // The process-level 'ready' (transport already settled by the reader)
+    if (msg.kind == InboundKind::READY && msg.channel == 0) {
+        ready_ = true;
+        
+        std::vector<std::function<void(const InboundMessage&)>> handlers;
+        for (const auto& entry : clients_) {
+            handlers.push_back(entry.second.on_message);
+        }
+        for (const auto& handler : handlers) {
+            handler(msg);
+        }
+        return;
+    }
+    
+    // Output from outside any script's context goes to the oldest channel
+    auto it = (msg.channel == 0) ? clients_.begin() : clients_.find(msg.channel);
+    if (it != clients_.end()) {
+        it->second.on_message(msg);
+    }
+}
+
+void SharedHost::notify_exit() {
+    // Clients close their channels (possibly destroying us) while we loop
+    std::vector<std::function<void()>> callbacks;
+    for (const auto& entry : clients_) {
+        callbacks.push_back(entry.second.on_exit);
+    }
+    for (const auto& callback : callbacks) {
+        callback();
+    }
+}
+
+} // namespace pdnode
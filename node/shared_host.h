@@ -0,0 +1,107 @@
+/**
+ * shared_host.h
+ * 
+ * One JS process serving many [node] objects, one channel per script
+ */
+
+#ifndef PD_NODE_SHARED_HOST_H
+#define PD_NODE_SHARED_HOST_H
+
+#include "inbound.h"
+#include "ipc_bridge.h"
+#include <functional>
+#include <map>
+#include <string>
+
+namespace pdnode {
+
+/**
+ * Callbacks for one script living in a shared host
+ */
+struct HostClient {
+    std::function<void(const InboundMessage&)> on_message;  // Message for this channel
+    std::function<void()> on_exit;                          // The host process died
+};
+
+/**
+ * Shared Host - a named runtime process that loads several scripts, each in
+ * its own module scope, and routes frames to them by channel id
+ * 
+ * Not thread-safe: only used from Pd's main thread.
+ */
+class SharedHost {
+public:
+    /**
+     * Find the host called `name` for this runtime/options, or spawn it
+     * 
+     * @param created Set to true if a new process was spawned
+     * @return Host, or nullptr if spawning failed
+     */
+    static SharedHost* acquire(const std::string& name, const std::string& runtime_path,
+                               const std::string& wrapper_path, const BridgeOptions& options, bool& created);
+    
+    /**
+     * Shut the host down once close_channel() reported it unused
+     */
+    static void destroy(SharedHost* host);
+    
+    /**
+     * Load a script on a new channel
+     * Returns the channel id (never 0)
+     */
+    uint32_t open_channel(const std::string& script_path, const HostClient& client);
+    
+    /**
+     * Unload the script on `channel`
+     * Returns true if no channels are left (caller should destroy the host)
+     */
+    bool close_channel(uint32_t channel);
+    
+    /**
+     * Read everything the host wrote and dispatch() it
+     */
+    size_t receive_messages();
+    
+    /**
+     * Hand a decoded message to its channel. The host's own 'ready' is
+     * handled here and then passed to every channel.
+     */
+    void dispatch(const InboundMessage& msg);
+    
+    /**
+     * Tell every client that the process is gone. Clients normally close
+     * their channel, so the host may be destroyed when this returns.
+     */
+    void notify_exit();
+    
+    IPCBridge& bridge() { return bridge_; }
+    const std::string& name() const { return name_; }
+    bool is_ready() const { return ready_; }
+    
+    /**
+     * IOThread registration when the host is read there (0 otherwise)
+     */
+    uint64_t io_watch() const { return io_watch_; }
+    void set_io_watch(uint64_t id) { io_watch_ = id; }
+    
+private:
+    SharedHost(const std::string& name, const std::string& key, const std::string& runtime_path,
+               const std::string& wrapper_path, const BridgeOptions& options);
+    ~SharedHost();
+    SharedHost(const SharedHost&) = delete;
+    SharedHost& operator=(const SharedHost&) = delete;
+    
+    std::string name_;
+    std::string key_;
+    IPCBridge bridge_;
+    std::map<uint32_t, HostClient> clients_;
+    uint32_t next_channel_;
+    bool ready_;
+    uint64_t io_watch_;
+    
+    static std::map<std::string, SharedHost*>& registry();
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_SHARED_HOST_H
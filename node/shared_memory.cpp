@@ -0,0 +1,121 @@
+/**
+ * shared_memory.cpp
+ * 
+ * Anonymous shared memory region that can be inherited by the JS child
+ */
+
+#include "shared_memory.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <iostream>
+
+namespace pdnode {
+
+SharedMemory::SharedMemory()
+    : data_(nullptr)
+    , size_(0)
+    , fd_(-1)
+{
+}
+
+SharedMemory::~SharedMemory() {
+    release();
+}
+
+// Open an anonymous file descriptor suitable for a shared mapping
+static int open_anonymous_fd(const char* name) {
+#ifdef __linux__
+    return memfd_create(name, MFD_CLOEXEC);
+#else
+    // No memfd: use a temp file that is unlinked right away
+    const char* tmpdir = getenv("TMPDIR");
+    std::string path = std::string(tmpdir ? tmpdir : "/tmp") + "/pd-node-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd >= 0) {
+        unlink(path.c_str());
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    return fd;
+#endif
+}
+
+bool SharedMemory::create(size_t size, const char* name) {
+    release();
+    
+    int fd = open_anonymous_fd(name);
+    if (fd < 0) {
+        std::cerr << "[node] Failed to create shared memory" << std::endl;
+        return false;
+    }
+    
+    return map(fd, size);
+}
+
+bool SharedMemory::create_file(size_t size) {
+    release();
+    
+    // tmpfs on Linux keeps it out of the page cache of a real disk
+    const char* tmpdir = getenv("TMPDIR");
+    std::string dir = tmpdir ? tmpdir : "/tmp";
+#ifdef __linux__
+    if (access("/dev/shm", W_OK) == 0) {
+        dir = "/dev/shm";
+    }
+#endif
+    std::string path = dir + "/pd-node-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        std::cerr << "[node] Failed to create shared memory file" << std::endl;
+        return false;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (!map(fd, size)) {
+        unlink(path.c_str());
+        return false;
+    }
+    path_ = path;
+    return true;
+}
+
+// Size the file behind `fd` and map it; closes `fd` on failure
+bool SharedMemory::map(int fd, size_t size) {
+    if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+        std::cerr << "[node] Failed to size shared memory" << std::endl;
+        close(fd);
+        return false;
+    }
+    
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        std::cerr << "[node] Failed to map shared memory" << std::endl;
+        close(fd);
+        return false;
+    }
+    
+    data_ = data;
+    size_ = size;
+    fd_ = fd;
+    return true;
+}
+
+void SharedMemory::release() {
+    if (data_) {
+        munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    // Mappings made by others stay valid
+    if (!path_.empty()) {
+        unlink(path_.c_str());
+        path_.clear();
+    }
+}
+
+} // namespace pdnode
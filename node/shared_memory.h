@@ -0,0 +1,62 @@
+/**
+ * shared_memory.h
+ * 
+ * Anonymous shared memory region that can be inherited by the JS child
+ * (memfd on Linux, unlinked temp file elsewhere), or a named one that an
+ * already running child maps by path
+ */
+
+#ifndef PD_NODE_SHARED_MEMORY_H
+#define PD_NODE_SHARED_MEMORY_H
+
+#include <cstddef>
+#include <string>
+
+namespace pdnode {
+
+/**
+ * Shared Memory - mmap'd region backed by a file descriptor
+ */
+class SharedMemory {
+public:
+    SharedMemory();
+    ~SharedMemory();
+    
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+    
+    /**
+     * Create and map a zero-filled region of `size` bytes
+     * Returns true if successful
+     */
+    bool create(size_t size, const char* name);
+    
+    /**
+     * Like create(), but backed by a file other processes can open by
+     * path() (in /dev/shm where available); release() removes it
+     */
+    bool create_file(size_t size);
+    
+    /**
+     * Unmap the region, close the descriptor and remove a file
+     */
+    void release();
+    
+    bool valid() const { return data_ != nullptr; }
+    void* data() const { return data_; }
+    size_t size() const { return size_; }
+    int fd() const { return fd_; }
+    const std::string& path() const { return path_; }
+    
+private:
+    bool map(int fd, size_t size);
+    
+    void* data_;
+    size_t size_;
+    int fd_;
+    std::string path_;  // create_file() only
+};
+
+} // namespace pdnode
+
+#endif // PD_NODE_SHARED_MEMORY_H
@@ -0,0 +1,140 @@
+/**
+ * shm_ring.cpp
+ * 
+ * Lock-free SPSC message ring in shared memory
+ */
+
+#include "shm_ring.h"
+#include <cstring>
+#include <new>
+
+namespace pdnode {
+
+static inline uint32_t padded(size_t len) {
+    return static_cast<uint32_t>((len + 3) & ~static_cast<size_t>(3));
+}
+
+ShmRing::ShmRing()
+    : head_(nullptr)
+    , tail_(nullptr)
+    , waiting_(nullptr)
+    , data_(nullptr)
+    , capacity_(0)
+    , front_next_(0)
+    , corrupt_(false)
+{
+}
+
+void ShmRing::init(void* base, uint32_t capacity) {
+    char* bytes = static_cast<char*>(base);
+    
+    uint32_t magic = kMagic;
+    std::memcpy(bytes, &magic, 4);
+    std::memcpy(bytes + 4, &capacity, 4);
+    
+    head_ = new (bytes + 64) std::atomic<uint32_t>(0);
+    tail_ = new (bytes + 128) std::atomic<uint32_t>(0);
+    waiting_ = new (bytes + 192) std::atomic<uint32_t>(0);
+    data_ = bytes + kHeaderSize;
+    capacity_ = capacity;
+    corrupt_ = false;
+}
+
+bool ShmRing::push(const char* data, size_t len) {
+    if (len > max_payload()) {
+        return false;
+    }
+    
+    uint32_t head = head_->load(std::memory_order_relaxed);
+    uint32_t tail = tail_->load(std::memory_order_acquire);
+    uint32_t need = 4 + padded(len);
+    uint32_t pos = head & (capacity_ - 1);
+    uint32_t to_end = capacity_ - pos;
+    uint32_t total = (to_end < need) ? to_end + need : need;
+    
+    if (capacity_ - (head - tail) < total) {
+        return false;  // Full
+    }
+    
+    if (to_end < need) {
+        // Not enough contiguous room: mark the gap and wrap
+        uint32_t marker = kWrapMarker;
+        std::memcpy(data_ + pos, &marker, 4);
+        head += to_end;
+        pos = 0;
+    }
+    
+    uint32_t len32 = static_cast<uint32_t>(len);
+    std::memcpy(data_ + pos, &len32, 4);
+    std::memcpy(data_ + pos + 4, data, len);
+    
+    head_->store(head + need, std::memory_order_seq_cst);
+    return true;
+}
+
+bool ShmRing::front(const char** data, size_t* len) {
+    if (corrupt_) {
+        return false;
+    }
+    uint32_t tail = tail_->load(std::memory_order_relaxed);
+    uint32_t head = head_->load(std::memory_order_acquire);
+    
+    if (tail == head) {
+        return false;
+    }
+    
+    // The script writes head and the lengths: trust neither further than
+    // the readable bytes and the data area
+    uint32_t readable = head - tail;
+    uint32_t pos = tail & (capacity_ - 1);
+    uint32_t skipped = 0;
+    uint32_t len32;
+    if (readable > capacity_ || readable < 4) {
+        corrupt_ = true;
+        return false;
+    }
+    std::memcpy(&len32, data_ + pos, 4);
+    
+    if (len32 == kWrapMarker) {
+        skipped = capacity_ - pos;
+        if (readable < skipped + 4) {
+            corrupt_ = true;
+            return false;
+        }
+        pos = 0;
+        std::memcpy(&len32, data_, 4);
+    }
+    
+    if (len32 > capacity_ - pos - 4 || skipped + 4 + padded(len32) > readable) {
+        corrupt_ = true;
+        return false;
+    }
+    
+    *data = data_ + pos + 4;
+    *len = len32;
+    front_next_ = tail + skipped + 4 + padded(len32);
+    return true;
+}
+
+void ShmRing::pop_front() {
+    tail_->store(front_next_, std::memory_order_release);
+}
+
+bool ShmRing::empty() const {
+    return tail_->load(std::memory_order_relaxed) == head_->load(std::memory_order_seq_cst);
+}
+
+bool ShmRing::take_waiting() {
+    // Pairs with set_waiting(): the head store above is seq_cst, so either we
+    // see the flag or the consumer sees our record on its re-check.
+    if (waiting_->load(std::memory_order_seq_cst) == 0) {
+        return false;
+    }
+    return waiting_->exchange(0, std::memory_order_seq_cst) != 0;
+}
+
+void ShmRing::set_waiting(bool waiting) {
+    waiting_->store(waiting ? 1 : 0, std::memory_order_seq_cst);
+}
+
+} // namespace pdnode
@@ -0,0 +1,102 @@
+/**
+ * shm_ring.h
+ * 
+ * Lock-free single-producer/single-consumer message ring living in
+ * shared memory. wrapper.js implements the same layout (see ShmRing there).
+ * 
+ * Layout (little endian, offsets in bytes from the ring base):
+ *   0    u32 magic ('PDRB')
+ *   4    u32 capacity (data bytes, power of two)
+ *   64   u32 head     (producer cursor, free-running)
+ *   128  u32 tail     (consumer cursor, free-running)
+ *   192  u32 waiting  (consumer is asleep and wants a doorbell)
+ *   256  data[capacity]
+ * 
+ * Each record is a u32 payload length followed by the payload, padded to
+ * 4 bytes. Records never straddle the end of the data area: a length of
+ * 0xFFFFFFFF tells the consumer to skip to the start.
+ */
+
+#ifndef PD_NODE_SHM_RING_H
+#define PD_NODE_SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace pdnode {
+
+class ShmRing {
+public:
+    static constexpr uint32_t kMagic = 0x42524450;  // 'PDRB'
+    static constexpr size_t kHeaderSize = 256;
+    
+    ShmRing();
+    
+    /**
+     * Bytes needed for a ring with `capacity` data bytes
+     */
+    static size_t region_size(uint32_t capacity) { return kHeaderSize + capacity; }
+    
+    /**
+     * Initialize a fresh ring at `base` (capacity must be a power of two)
+     */
+    void init(void* base, uint32_t capacity);
+    
+    /**
+     * Largest payload a single record can carry
+     */
+    size_t max_payload() const { return capacity_ / 2 - 4; }
+    
+    /**
+     * Producer: append one record. Returns false if there is not enough room.
+     */
+    bool push(const char* data, size_t len);
+    
+    /**
+     * Consumer: look at the oldest record in place (records are always
+     * contiguous). Returns false if the ring is empty or corrupt().
+     */
+    bool front(const char** data, size_t* len);
+    
+    /**
+     * Consumer: a record was out of bounds. The ring can't be read any
+     * more; the caller should stop using it.
+     */
+    bool corrupt() const { return corrupt_; }
+    
+    /**
+     * Consumer: release the record returned by front()
+     */
+    void pop_front();
+    
+    bool empty() const;
+    
+    /**
+     * Producer: returns true (once) if the consumer asked for a doorbell
+     */
+    bool take_waiting();
+    
+    /**
+     * Consumer: announce that we are about to sleep until a doorbell
+     */
+    void set_waiting(bool waiting);
+    
+private:
+    static constexpr uint32_t kWrapMarker = 0xFFFFFFFF;
+    
+    std::atomic<uint32_t>* head_;
+    std::atomic<uint32_t>* tail_;
+    std::atomic<uint32_t>* waiting_;
+    char* data_;
+    uint32_t capacity_;
+    uint32_t front_next_;  // Tail after the record returned by front()
+    bool corrupt_;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "shared memory rings need address-free atomics");
+
+} // namespace pdnode
+
+#endif // PD_NODE_SHM_RING_H
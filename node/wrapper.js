@@ -5,81 +5,895 @@
  * It sets up the pd-api environment and message handling.
  */
 
-// Create the internal API that pd-api will use
-global.__pd_internal__ = {
-    handlers: {
-        bang: [],
-        float: [],
-        symbol: [],
-        list: [],
-        anything: []
-    },
+// Wire framing negotiated by IPCBridge at spawn time (mirror of node/frame.h)
+const binaryFraming = process.env.PD_NODE_FRAMING === 'binary';
+const FRAME_HEADER_SIZE = 8;
+const FRAME = {
+    JSON: 0,
+    READY: 1,
+    MESSAGE: 2,
+    OUTLET: 3,
+    LOG: 4,
+    ERROR: 5,
+    LOAD: 6,
+    UNLOAD: 7,
+    ARRAY: 8
+};
+const FRAME_FLAG_CHANNEL = 0x01;  // u32 channel follows the header (shared host)
+const FRAME_FLAG_TIME = 0x02;     // f64 Pd logical time (ms) follows
+const FRAME_FLAG_SEQ = 0x04;      // u32 sequence number of the message being answered
+
+function encodeFrame(type, port, payload, channel = 0, time = 0, seq = 0) {
+    const ext = (channel ? 4 : 0) + (time ? 8 : 0) + (seq ? 4 : 0);
+    const frame = Buffer.allocUnsafe(FRAME_HEADER_SIZE + ext + payload.length);
+    frame.writeUInt32LE(ext + payload.length, 0);
+    frame.writeUInt8(type, 4);
+    frame.writeUInt8((channel ? FRAME_FLAG_CHANNEL : 0) | (time ? FRAME_FLAG_TIME : 0)
+                     | (seq ? FRAME_FLAG_SEQ : 0), 5);
+    frame.writeUInt16LE(port, 6);
+    let offset = FRAME_HEADER_SIZE;
+    if (channel) {
+        frame.writeUInt32LE(channel, offset);
+        offset += 4;
+    }
+    if (time) {
+        frame.writeDoubleLE(time, offset);
+        offset += 8;
+    }
+    if (seq) {
+        frame.writeUInt32LE(seq, offset);
+        offset += 4;
+    }
+    payload.copy(frame, offset);
+    return frame;
+}
+
+// Split one encoded frame into its fields and handle it
+function decodeFrame(buffer, start, end) {
+    const flags = buffer.readUInt8(start + 5);
+    let payloadStart = start + FRAME_HEADER_SIZE;
+    let channel = 0;
+    if (flags & FRAME_FLAG_CHANNEL) {
+        channel = buffer.readUInt32LE(payloadStart);
+        payloadStart += 4;
+    }
+    let time = 0;
+    if (flags & FRAME_FLAG_TIME) {
+        time = buffer.readDoubleLE(payloadStart);
+        payloadStart += 8;
+    }
+    let seq = 0;
+    if (flags & FRAME_FLAG_SEQ) {
+        seq = buffer.readUInt32LE(payloadStart);
+        payloadStart += 4;
+    }
+    handleFrame(buffer.readUInt8(start + 4), buffer.readUInt16LE(start + 6),
+                buffer.subarray(payloadStart, end), channel, time, seq);
+}
+
+// Compact atom codec for MESSAGE/OUTLET payloads (mirror of node/atom_codec.h)
+const ATOM = {
+    FLOAT: 0x01,
+    SYMBOL: 0x02,
+    SYMBOL_DEF: 0x03,
+    SYMBOL_REF: 0x04,
+    FLOAT_ARRAY: 0x05,
+    SEL_BANG: 0x10,
+    SEL_FLOAT: 0x11,
+    SEL_SYMBOL: 0x12,
+    SEL_LIST: 0x13
+};
+const SELECTOR_TAGS = { bang: ATOM.SEL_BANG, float: ATOM.SEL_FLOAT, symbol: ATOM.SEL_SYMBOL, list: ATOM.SEL_LIST, anything: ATOM.SEL_LIST };
+const SELECTOR_NAMES = { [ATOM.SEL_BANG]: 'bang', [ATOM.SEL_FLOAT]: 'float', [ATOM.SEL_SYMBOL]: 'symbol', [ATOM.SEL_LIST]: 'list' };
+
+let atomScratch = Buffer.allocUnsafe(4096);
+
+function reserveAtoms(offset, bytes) {
+    if (offset + bytes > atomScratch.length) {
+        const grown = Buffer.allocUnsafe(Math.max(atomScratch.length * 2, offset + bytes));
+        atomScratch.copy(grown, 0, 0, offset);
+        atomScratch = grown;
+    }
+}
+
+// Symbols sent to Pd are interned per channel: the first use defines an
+// id, later ones send just the id. Ids are never reused within a channel.
+const SYMBOL_INTERN_MAX = 256;  // Longer strings are always sent in full
+const symbolTables = new Map();
+let hostingScripts = false;  // Channel 0 output then goes to whichever script is oldest
+
+function symbolTable(channel) {
+    if (channel === 0 && hostingScripts) {
+        return undefined;
+    }
+    let table = symbolTables.get(channel);
+    if (!table) {
+        table = { ids: new Map(), next: 0 };
+        symbolTables.set(channel, table);
+    }
+    return table;
+}
+
+// A frame was lost: stop referring to ids it may have defined
+function forgetSymbols() {
+    for (const table of symbolTables.values()) {
+        table.ids.clear();
+    }
+}
+
+function writeSymbol(offset, str, table) {
+    if (table) {
+        const id = table.ids.get(str);
+        if (id !== undefined) {
+            reserveAtoms(offset, 3);
+            atomScratch[offset] = ATOM.SYMBOL_REF;
+            atomScratch.writeUInt16LE(id, offset + 1);
+            return offset + 3;
+        }
+    }
+    const len = Math.min(Buffer.byteLength(str), 0xFFFF);
+    if (table && len <= SYMBOL_INTERN_MAX && table.next <= 0xFFFF) {
+        const id = table.next++;
+        table.ids.set(str, id);
+        reserveAtoms(offset, 5 + len);
+        atomScratch[offset] = ATOM.SYMBOL_DEF;
+        atomScratch.writeUInt16LE(id, offset + 1);
+        const written = atomScratch.write(str, offset + 5, len);
+        atomScratch.writeUInt16LE(written, offset + 3);
+        return offset + 5 + written;
+    }
+    reserveAtoms(offset, 3 + len);
+    atomScratch[offset] = ATOM.SYMBOL;
+    const written = atomScratch.write(str, offset + 3, len);
+    atomScratch.writeUInt16LE(written, offset + 1);
+    return offset + 3 + written;
+}
+
+// Long numeric lists and typed arrays go as one packed FLOAT_ARRAY
+const FLOAT_ARRAY_MIN = 8;  // Mirror of kFloatArrayMin
+
+function isTypedArray(value) {
+    return ArrayBuffer.isView(value) && !(value instanceof DataView);
+}
+
+function isFloatList(values) {
+    if (isTypedArray(values)) {
+        return true;
+    }
+    if (values.length < FLOAT_ARRAY_MIN) {
+        return false;
+    }
+    for (const value of values) {
+        if (typeof value !== 'number') {
+            return false;
+        }
+    }
+    return true;
+}
+
+function writeFloatArray(offset, values) {
+    const count = values.length;
+    reserveAtoms(offset, 5 + count * 4);
+    atomScratch[offset] = ATOM.FLOAT_ARRAY;
+    atomScratch.writeUInt32LE(count, offset + 1);
+    offset += 5;
+    if (values instanceof Float32Array) {
+        // Same byte order on both sides (little endian hosts)
+        atomScratch.set(new Uint8Array(values.buffer, values.byteOffset, count * 4), offset);
+    } else {
+        for (let i = 0; i < count; i++) {
+            atomScratch.writeFloatLE(Number(values[i]), offset + i * 4);
+        }
+    }
+    return offset + count * 4;
+}
+
+// Nested arrays and typed arrays as one flat list (JSON framing)
+function flattenArgs(values, out = []) {
+    for (const value of values) {
+        if (Array.isArray(value) || isTypedArray(value)) {
+            flattenArgs(value, out);
+        } else {
+            out.push(value);
+        }
+    }
+    return out;
+}
+
+function writeAtom(offset, value, table) {
+    if (Array.isArray(value) || isTypedArray(value)) {
+        if (isFloatList(value)) {
+            return writeFloatArray(offset, value);
+        }
+        for (const item of value) {
+            offset = writeAtom(offset, item, table);
+        }
+        return offset;
+    }
+    if (typeof value === 'number' || typeof value === 'boolean') {
+        reserveAtoms(offset, 5);
+        atomScratch[offset] = ATOM.FLOAT;
+        atomScratch.writeFloatLE(Number(value), offset + 1);
+        return offset + 5;
+    }
+    return writeSymbol(offset, String(value), table);
+}
+
+// Encode selector + args; returns a view of the scratch buffer.
+// Symbols are interned in `table` if given.
+function encodeAtoms(selector, args, table) {
+    let offset;
+    const tag = SELECTOR_TAGS[selector];
+    if (tag !== undefined) {
+        reserveAtoms(0, 1);
+        atomScratch[0] = tag;
+        offset = 1;
+    } else {
+        offset = writeSymbol(0, String(selector), table);
+    }
+    offset = writeAtom(offset, args, table);
+    return atomScratch.subarray(0, offset);
+}
+
+function decodeAtoms(payload) {
+    let selector = null;
+    const args = [];
+    let offset = 0;
+    while (offset < payload.length) {
+        const tag = payload[offset++];
+        let value;
+        if (tag === ATOM.FLOAT) {
+            value = payload.readFloatLE(offset);
+            offset += 4;
+        } else if (tag === ATOM.SYMBOL) {
+            const len = payload.readUInt16LE(offset);
+            value = payload.toString('utf8', offset + 2, offset + 2 + len);
+            offset += 2 + len;
+        } else if (tag === ATOM.FLOAT_ARRAY && selector !== null) {
+            const count = payload.readUInt32LE(offset);
+            const values = new Float32Array(count);
+            new Uint8Array(values.buffer).set(payload.subarray(offset + 4, offset + 4 + count * 4));
+            offset += 4 + count * 4;
+            // Handlers are applied to args, so a lone block is passed as is
+            if (args.length === 0 && offset >= payload.length) {
+                return { selector, args: values };
+            }
+            for (const value of values) {
+                args.push(value);
+            }
+            continue;
+        } else if (SELECTOR_NAMES[tag] !== undefined && selector === null) {
+            selector = SELECTOR_NAMES[tag];
+            continue;
+        } else {
+            throw new Error('bad atom tag ' + tag);
+        }
+        if (selector === null) {
+            selector = value;
+        } else {
+            args.push(value);
+        }
+    }
+    return { selector, args };
+}
+
+// Lock-free SPSC ring in shared memory (mirror of node/shm_ring.h)
+const RING_MAGIC = 0x42524450;  // 'PDRB'
+const RING_HEADER_SIZE = 256;
+const RING_WRAP = 0xFFFFFFFF;
+
+class ShmRing {
+    constructor(bytes, offset) {
+        const header = new Uint32Array(bytes.buffer, bytes.byteOffset + offset, RING_HEADER_SIZE / 4);
+        if (header[0] !== RING_MAGIC) {
+            throw new Error('bad ring magic');
+        }
+        this.capacity = header[1];
+        this.header = header;    // head at [16], tail at [32], waiting at [48]
+        this.data = bytes.subarray(offset + RING_HEADER_SIZE, offset + RING_HEADER_SIZE + this.capacity);
+        this.view = new DataView(this.data.buffer, this.data.byteOffset, this.capacity);
+        this.size = RING_HEADER_SIZE + this.capacity;
+        this.maxRecord = this.capacity / 2 - 4;  // Longest payload push() takes
+    }
+    
+    push(payload) {
+        const len = payload.length;
+        if (len > this.maxRecord) {
+            throw new Error('message too large for shared memory ring');
+        }
+        const head = Atomics.load(this.header, 16);
+        const tail = Atomics.load(this.header, 32);
+        const need = 4 + ((len + 3) & ~3);
+        let pos = head & (this.capacity - 1);
+        const toEnd = this.capacity - pos;
+        const total = toEnd < need ? toEnd + need : need;
+        
+        if (this.capacity - ((head - tail) >>> 0) < total) {
+            return false;
+        }
+        
+        let next = head;
+        if (toEnd < need) {
+            this.view.setUint32(pos, RING_WRAP, true);
+            next = (next + toEnd) >>> 0;
+            pos = 0;
+        }
+        this.view.setUint32(pos, len, true);
+        this.data.set(payload, pos + 4);
+        Atomics.store(this.header, 16, (next + need) >>> 0);
+        return true;
+    }
     
-    // Called by pd-api when user registers a handler
-    register: function(selector, handler) {
-        if (!this.handlers[selector]) {
-            this.handlers[selector] = [];
+    pop() {
+        let tail = Atomics.load(this.header, 32);
+        const head = Atomics.load(this.header, 16);
+        if (tail === head) {
+            return null;
+        }
+        let pos = tail & (this.capacity - 1);
+        let len = this.view.getUint32(pos, true);
+        if (len === RING_WRAP) {
+            tail = (tail + this.capacity - pos) >>> 0;
+            pos = 0;
+            len = this.view.getUint32(0, true);
         }
-        this.handlers[selector].push(handler);
-    },
+        const payload = Buffer.from(this.data.subarray(pos + 4, pos + 4 + len));
+        Atomics.store(this.header, 32, (tail + 4 + ((len + 3) & ~3)) >>> 0);
+        return payload;
+    }
     
-    // Called when we receive a message from C++
-    dispatch: function(msg) {
-        const selector = msg.selector || 'anything';
-        const handlers = this.handlers[selector] || [];
+    empty() {
+        return Atomics.load(this.header, 32) === Atomics.load(this.header, 16);
+    }
+    
+    // Producer side: true (once) if the consumer is asleep
+    takeWaiting() {
+        return Atomics.load(this.header, 48) !== 0 && Atomics.exchange(this.header, 48, 0) !== 0;
+    }
+    
+    setWaiting(waiting) {
+        Atomics.store(this.header, 48, waiting ? 1 : 0);
+    }
+}
+
+// Attach to the rings set up by IPCBridge (--shm). Needs Bun.mmap.
+function attachSharedMemory() {
+    const fd = process.env.PD_NODE_SHM_FD;
+    if (!fd || typeof Bun === 'undefined' || typeof Bun.mmap !== 'function') {
+        return null;
+    }
+    try {
+        const bytes = Bun.mmap('/dev/fd/' + fd, { shared: true });
+        const toJs = new ShmRing(bytes, 0);
+        const fromJs = new ShmRing(bytes, toJs.size);
+        return { bytes, toJs, fromJs, pending: [], flushTimer: null, dropped: 0 };
+    } catch (err) {
+        return null;
+    }
+}
+
+const shm = attachSharedMemory();
+
+// Signal blocks of a [node~] (mirror of node/audio_exchange.h)
+const AUDIO_MAGIC = 0x55414450;  // 'PDAU'
+const AUDIO_HEADER_SIZE = 256;
+const AUDIO_SLOT_HEADER_SIZE = 16;
+
+class AudioExchange {
+    constructor(bytes, offset) {
+        const header = new Uint32Array(bytes.buffer, bytes.byteOffset + offset, AUDIO_HEADER_SIZE / 4);
+        if (header[0] !== AUDIO_MAGIC) {
+            throw new Error('bad audio magic');
+        }
+        this.header = header;    // written at [16]
+        this.rate = new Float32Array(header.buffer, header.byteOffset + 24, 1);
+        this.inputs = header[1];
+        this.outputs = header[2];
+        this.slots = header[3];
+        this.maxBlock = header[4];
+        this.next = Atomics.load(header, 16);  // Next block to process
         
-        for (const handler of handlers) {
-            try {
-                handler.apply(null, msg.args || []);
-            } catch (err) {
-                this.error('Handler error: ' + err.message);
+        // Per slot: its tag and a view of every channel at full size
+        const slotSize = AUDIO_SLOT_HEADER_SIZE + (this.inputs + this.outputs) * this.maxBlock * 4;
+        this.slotViews = [];
+        for (let i = 0; i < this.slots; i++) {
+            const base = bytes.byteOffset + offset + AUDIO_HEADER_SIZE + i * slotSize;
+            const channels = [];
+            for (let c = 0; c < this.inputs + this.outputs; c++) {
+                channels.push(new Float32Array(bytes.buffer, base + AUDIO_SLOT_HEADER_SIZE + c * this.maxBlock * 4, this.maxBlock));
             }
+            this.slotViews.push({ tag: new Uint32Array(bytes.buffer, base, 1), channels });
         }
-    },
+        this.blockSize = 0;
+        this.blocks = [];  // Per slot: { inputs, outputs } sized to blockSize
+    }
     
-    // Send message to PD outlet
-    outlet: function(outlet, selector, ...args) {
-        const msg = {
-            type: 'outlet',
-            outlet: outlet,
-            selector: selector,
-            args: args
-        };
-        process.stdout.write(JSON.stringify(msg) + '\n');
-    },
+    get sampleRate() {
+        return this.rate[0];
+    }
     
-    // Log message to PD console
-    post: function(message) {
-        const msg = {
-            type: 'log',
-            message: String(message)
-        };
-        process.stdout.write(JSON.stringify(msg) + '\n');
-    },
+    pending() {
+        return Atomics.load(this.header, 16) !== this.next;
+    }
     
-    // Error message to PD console
-    error: function(message) {
-        const msg = {
-            type: 'error',
-            message: String(message)
-        };
-        process.stdout.write(JSON.stringify(msg) + '\n');
+    // Views are only rebuilt when Pd's block size changes
+    views(slot) {
+        const blockSize = this.header[5];
+        if (blockSize !== this.blockSize) {
+            this.blockSize = blockSize;
+            this.blocks = this.slotViews.map(({ channels }) => ({
+                inputs: channels.slice(0, this.inputs).map((c) => c.subarray(0, blockSize)),
+                outputs: channels.slice(this.inputs).map((c) => c.subarray(0, blockSize))
+            }));
+        }
+        return this.blocks[slot];
     }
-};
+    
+    // Run `callback(inputs, outputs)` for every block Pd has published
+    process(callback) {
+        const written = Atomics.load(this.header, 16);
+        // Blocks older than the ring have been overwritten by now
+        if (((written - this.next) >>> 0) > this.slots) {
+            this.next = (written - this.slots) >>> 0;
+        }
+        while (this.next !== written) {
+            const slot = this.next % this.slots;
+            const { inputs, outputs } = this.views(slot);
+            for (const output of outputs) {
+                output.fill(0);
+            }
+            if (callback) {
+                callback(inputs, outputs);
+            }
+            this.next = (this.next + 1) >>> 0;
+            Atomics.store(this.slotViews[slot].tag, 0, this.next);
+        }
+    }
+}
+
+function attachAudio() {
+    const offset = process.env.PD_NODE_AUDIO_OFFSET;
+    if (!shm || !offset) {
+        return null;
+    }
+    try {
+        return new AudioExchange(shm.bytes, Number(offset));
+    } catch (err) {
+        return null;
+    }
+}
+
+const audio = attachAudio();
+
+function processAudio() {
+    const context = rootContext;
+    try {
+        audio.process(context.dspCallback);
+    } catch (err) {
+        // Don't report the same failure every block
+        context.dspCallback = null;
+        context.error('DSP callback error: ' + err.message);
+    }
+}
+
+// Outgoing records are batched and written once the current handler
+// (and everything it triggered synchronously) has finished
+let outQueue = [];
+let outScheduled = false;
+
+// Records waiting for room in the shared memory ring; more than this means
+// Pd isn't reading, and new ones are dropped (the C++ side's default --queue)
+const SHM_MAX_PENDING = 4096;
+
+function writeRecord(record, channel = 0) {
+    if (shm && !admitShared(record, channel)) {
+        return;
+    }
+    outQueue.push(binaryFraming || shm ? record : record + '\n');
+    if (!outScheduled) {
+        outScheduled = true;
+        queueMicrotask(flushOutput);
+    }
+}
+
+// Send queued records to C++ (pipe, or shared memory ring once attached)
+function flushOutput() {
+    outScheduled = false;
+    if (outQueue.length === 0) {
+        return;
+    }
+    const batch = outQueue;
+    outQueue = [];
+    
+    if (!shm) {
+        process.stdout.write(binaryFraming ? Buffer.concat(batch) : batch.join(''));
+        return;
+    }
+    for (const record of batch) {
+        shm.pending.push(typeof record === 'string' ? Buffer.from(record) : record);
+    }
+    flushShared();
+}
+
+// Send one message, framed according to the negotiated mode
+function send(type, port, fields, channel = 0) {
+    if (!binaryFraming) {
+        if (channel) {
+            fields.channel = channel;
+        }
+        if (fields.args) {
+            fields.args = flattenArgs(fields.args);
+        }
+        writeRecord(JSON.stringify(fields), channel);
+        return;
+    }
+    // Type and port travel in the header; logs are raw text
+    let payload;
+    if (type === FRAME.LOG || type === FRAME.ERROR) {
+        payload = Buffer.from(fields.message);
+    } else if (type === FRAME.ARRAY) {
+        payload = Buffer.from(fields.name);
+    } else if (type === FRAME.OUTLET) {
+        payload = encodeAtoms(fields.selector, fields.args, symbolTable(channel));
+    } else {
+        payload = encodeAtoms(fields.selector, fields.args);
+    }
+    writeRecord(encodeFrame(type, port, payload, channel, fields.time || 0, fields.seq || 0), channel);
+}
+
+// Check that a record can go through the ring before queueing it. A
+// dropped record takes its symbol definitions along, so interning restarts.
+function admitShared(record, channel) {
+    const length = typeof record === 'string' ? Buffer.byteLength(record) : record.length;
+    if (length > shm.fromJs.maxRecord) {
+        forgetSymbols();
+        const context = contexts.get(channel);
+        (context && !context.closed ? context : rootContext).error(
+            `Message too large for shared memory (${length} bytes, at most ${shm.fromJs.maxRecord}), dropped`);
+        return false;
+    }
+    if (shm.pending.length + outQueue.length >= SHM_MAX_PENDING) {
+        forgetSymbols();
+        shm.dropped++;
+        return false;
+    }
+    return true;
+}
+
+function flushShared() {
+    let pushed = false;
+    while (shm.pending.length > 0) {
+        let ok;
+        try {
+            ok = shm.fromJs.push(shm.pending[0]);
+        } catch (err) {
+            shm.pending.shift();
+            forgetSymbols();
+            continue;
+        }
+        if (!ok) {
+            break;
+        }
+        shm.pending.shift();
+        pushed = true;
+    }
+    if (pushed && shm.fromJs.takeWaiting()) {
+        process.stdout.write('\n');
+    }
+    // Say so once Pd has caught up, when there is room for the message
+    if (shm.dropped > 0 && shm.pending.length === 0) {
+        const dropped = shm.dropped;
+        shm.dropped = 0;
+        rootContext.error(`Pd was not reading shared memory, dropped ${dropped} messages`);
+    }
+    // Ring full: retry once the Pd side has caught up
+    if (shm.pending.length > 0 && !shm.flushTimer) {
+        shm.flushTimer = setTimeout(() => {
+            shm.flushTimer = null;
+            flushShared();
+        }, 1);
+    }
+}
+
+// Create the internal API that pd-api will use. Each loaded script gets
+// its own context; its output is tagged with its channel (0 unless the
+// script lives in a shared host).
+function createContext(channel) {
+    return {
+        channel: channel,
+        closed: false,
+        dspCallback: null,
+        arrays: new Map(),  // Pd arrays mirrored for this script, by name
+        time: 0,            // Pd logical time of the last message ([node --time])
+        replySeq: 0,        // Sequence number of the message being handled
+        
+        handlers: {
+            bang: [],
+            float: [],
+            symbol: [],
+            list: [],
+            anything: []
+        },
+        
+        // Called by pd-api when user registers a handler
+        register: function(selector, handler) {
+            if (!this.handlers[selector]) {
+                this.handlers[selector] = [];
+            }
+            this.handlers[selector].push(handler);
+        },
+        
+        // Called by pd-api to process the signal blocks of a [node~]
+        setDsp: function(callback) {
+            if (!audio || this !== rootContext) {
+                this.error('pd.dsp() needs a [node~] running under Bun');
+                return;
+            }
+            this.dspCallback = callback;
+        },
+        
+        get sampleRate() {
+            return audio ? audio.sampleRate : 0;
+        },
+        
+        get blockSize() {
+            return audio ? audio.blockSize || audio.header[5] : 0;
+        },
+        
+        // Called by pd-api: the mirror of a shared Pd array, or undefined
+        array: function(name) {
+            const entry = this.arrays.get(name);
+            return entry ? entry.data : undefined;
+        },
+        
+        // Called by pd-api to have Pd copy a mirror back into its array
+        commit: function(name) {
+            if (this.closed) {
+                return;
+            }
+            if (!this.arrays.has(name)) {
+                this.error(`Array '${name}' is not shared`);
+                return;
+            }
+            send(FRAME.ARRAY, 0, { type: 'array', name: String(name) }, this.channel);
+        },
+        
+        // Called when we receive a message from C++
+        dispatch: function(msg) {
+            const selector = msg.selector || 'anything';
+            const handlers = this.handlers[selector] || [];
+            currentContext = this;
+            if (msg.time) {
+                this.time = msg.time;
+            }
+            
+            // Outlets sent from here on answer this message (Pd times the
+            // round trip); later, asynchronous ones don't
+            this.replySeq = msg.seq || 0;
+            for (const handler of handlers) {
+                try {
+                    handler.apply(null, msg.args || []);
+                } catch (err) {
+                    this.error('Handler error: ' + err.message);
+                }
+            }
+            this.replySeq = 0;
+        },
+        
+        // Send message to PD outlet
+        outlet: function(outlet, selector, ...args) {
+            if (this.closed) {
+                return;
+            }
+            const msg = {
+                type: 'outlet',
+                outlet: outlet,
+                selector: selector,
+                args: args
+            };
+            if (this.replySeq) {
+                msg.seq = this.replySeq;
+            }
+            send(FRAME.OUTLET, outlet, msg, this.channel);
+        },
+        
+        // Send to a PD outlet at a logical time (Pd holds it until then)
+        outletAt: function(time, outlet, selector, ...args) {
+            if (this.closed) {
+                return;
+            }
+            const msg = {
+                type: 'outlet',
+                outlet: outlet,
+                selector: selector,
+                args: args,
+                time: Number(time) || 0
+            };
+            if (this.replySeq) {
+                msg.seq = this.replySeq;
+            }
+            send(FRAME.OUTLET, outlet, msg, this.channel);
+        },
+        
+        // Log message to PD console
+        post: function(message) {
+            if (this.closed) {
+                return;
+            }
+            const msg = {
+                type: 'log',
+                message: String(message)
+            };
+            send(FRAME.LOG, 0, msg, this.channel);
+        },
+        
+        // Error message to PD console
+        error: function(message) {
+            if (this.closed) {
+                return;
+            }
+            const msg = {
+                type: 'error',
+                message: String(message)
+            };
+            send(FRAME.ERROR, 0, msg, this.channel);
+        }
+    };
+}
+
+const rootContext = createContext(0);
+const contexts = new Map([[0, rootContext]]);
+global.__pd_internal__ = rootContext;
+
+// console output goes to the script that ran last
+let currentContext = rootContext;
 
 // Override console.log to route through PD
 console.log = function(...args) {
-    global.__pd_internal__.post(args.join(' '));
+    (currentContext.closed ? rootContext : currentContext).post(args.join(' '));
 };
 
 console.error = function(...args) {
-    global.__pd_internal__.error(args.join(' '));
+    (currentContext.closed ? rootContext : currentContext).error(args.join(' '));
 };
 
+// Pd mirrored an array into a file for us (or stopped: no path)
+function shareArray(info, channel) {
+    const context = contexts.get(channel);
+    if (!context) {
+        return;
+    }
+    const { name, path, length } = info;
+    if (!path) {
+        context.arrays.delete(name);
+        return;
+    }
+    
+    // Same file: Pd copied the array again, the mapping is still good
+    let entry = context.arrays.get(name);
+    if (!entry || entry.path !== path) {
+        if (typeof Bun === 'undefined' || typeof Bun.mmap !== 'function') {
+            context.error(`Sharing array '${name}' needs Bun`);
+            return;
+        }
+        try {
+            entry = { path, bytes: Bun.mmap(path, { shared: true }), data: null };
+        } catch (err) {
+            context.error(`Could not map array '${name}': ${err.message}`);
+            return;
+        }
+        context.arrays.set(name, entry);
+    }
+    if (!entry.data || entry.data.length !== length) {
+        entry.data = new Float32Array(entry.bytes.buffer, entry.bytes.byteOffset, length);
+    }
+    context.dispatch({ selector: 'array', args: [name, entry.data] });
+}
+
+function handleMessage(msg) {
+    if (msg.type === 'message') {
+        // Dispatch to user's handlers
+        const context = contexts.get(msg.channel || 0);
+        if (context) {
+            context.dispatch(msg);
+        }
+    } else if (msg.type === 'load') {
+        loadScript(msg.script, msg.channel || 0);
+    } else if (msg.type === 'unload') {
+        unloadScript(msg.channel || 0);
+    } else if (msg.type === 'array') {
+        shareArray(msg, msg.channel || 0);
+    }
+}
+
+function handleFrame(type, port, payload, channel, time, seq) {
+    if (type === FRAME.MESSAGE) {
+        const context = contexts.get(channel);
+        if (context) {
+            const msg = decodeAtoms(payload);
+            msg.inlet = port;
+            msg.time = time;
+            msg.seq = seq;
+            context.dispatch(msg);
+        }
+    } else if (type === FRAME.JSON) {
+        handleMessage(JSON.parse(payload.toString()));
+    } else if (type === FRAME.LOAD) {
+        loadScript(payload.toString(), channel);
+    } else if (type === FRAME.UNLOAD) {
+        unloadScript(channel);
+    } else if (type === FRAME.ARRAY) {
+        shareArray(JSON.parse(payload.toString()), channel);
+    }
+}
+
+// One ring record holds exactly one frame (or one JSON line)
+function handleRecord(record) {
+    try {
+        if (!binaryFraming) {
+            handleMessage(JSON.parse(record.toString()));
+            return;
+        }
+        decodeFrame(record, 0, FRAME_HEADER_SIZE + record.readUInt32LE(0));
+    } catch (err) {
+        rootContext.error('Parse error: ' + err.message);
+    }
+}
+
+// Shared memory: stdin bytes are doorbells, messages live in the ring
+function drainShared() {
+    for (;;) {
+        let record;
+        while ((record = shm.toJs.pop()) !== null) {
+            handleRecord(record);
+        }
+        if (audio) {
+            processAudio();
+        }
+        // Ask for a doorbell, then re-check so a racing push is not missed
+        shm.toJs.setWaiting(true);
+        if (shm.toJs.empty() && !(audio && audio.pending())) {
+            return;
+        }
+        shm.toJs.setWaiting(false);
+    }
+}
+
 // Handle messages from C++ (via stdin)
 let stdinBuffer = '';
+let frameBuffer = Buffer.alloc(0);
+
+function readFrames(data) {
+    frameBuffer = frameBuffer.length ? Buffer.concat([frameBuffer, data]) : data;
+    
+    // The header says exactly where each frame ends
+    let offset = 0;
+    while (frameBuffer.length - offset >= FRAME_HEADER_SIZE) {
+        const length = frameBuffer.readUInt32LE(offset);
+        const end = offset + FRAME_HEADER_SIZE + length;
+        if (end > frameBuffer.length) {
+            break;
+        }
+        try {
+            decodeFrame(frameBuffer, offset, end);
+        } catch (err) {
+            rootContext.error('Parse error: ' + err.message);
+        }
+        offset = end;
+    }
+    frameBuffer = frameBuffer.subarray(offset);
+}
 
 process.stdin.on('data', (data) => {
+    if (shm) {
+        drainShared();
+        return;
+    }
+    if (binaryFraming) {
+        readFrames(data);
+        return;
+    }
+    
     stdinBuffer += data.toString();
     
     // Process complete lines
@@ -90,32 +904,101 @@ process.stdin.on('data', (data) => {
         
         if (line.trim()) {
             try {
-                const msg = JSON.parse(line);
-                
-                if (msg.type === 'message') {
-                    // Dispatch to user's handlers
-                    global.__pd_internal__.dispatch(msg);
-                }
+                handleMessage(JSON.parse(line));
             } catch (err) {
-                global.__pd_internal__.error('Parse error: ' + err.message);
+                rootContext.error('Parse error: ' + err.message);
             }
         }
     }
 });
 
-// Signal that we're ready
-process.stdout.write(JSON.stringify({ type: 'ready' }) + '\n');
+// Signal that we're ready (always over the pipe; rings are used after this)
+if (shm) {
+    shm.toJs.setWaiting(true);
+}
+const readyInfo = { type: 'ready', transport: shm ? 'shm' : 'pipe' };
+if (binaryFraming) {
+    process.stdout.write(encodeFrame(FRAME.READY, 0, Buffer.from(JSON.stringify(readyInfo))));
+} else {
+    process.stdout.write(JSON.stringify(readyInfo) + '\n');
+}
 
-// Now load the user's script (passed as first argument)
-const userScript = process.argv[2];
-if (userScript) {
+// Load the user's script; a failure ends the process so Pd notices
+let scriptLoaded = false;
+
+function loadScript(path, channel = 0) {
+    if (channel !== 0) {
+        hostingScripts = true;
+        loadSharedScript(path, channel);
+        return;
+    }
+    if (scriptLoaded) {
+        return;
+    }
+    scriptLoaded = true;
+    process.argv[2] = path;
     try {
-        require(userScript);
+        require(path);
     } catch (err) {
-        global.__pd_internal__.error('Failed to load script: ' + err.message);
+        rootContext.error('Failed to load script: ' + err.message);
+        flushOutput();
         process.exit(1);
     }
+}
+
+// Shared host: every script gets a fresh copy of its own modules (and of
+// pd-api, which binds to the context current at require time); packages
+// from node_modules are shared
+function loadSharedScript(path, channel) {
+    for (const key of Object.keys(require.cache)) {
+        if (!key.includes('node_modules') || /[\\/]pd-api[\\/]/.test(key)) {
+            delete require.cache[key];
+        }
+    }
+    
+    const context = createContext(channel);
+    contexts.set(channel, context);
+    global.__pd_internal__ = context;
+    currentContext = context;
+    try {
+        require(path);
+    } catch (err) {
+        // Only this script fails, the others keep running
+        context.error('Failed to load script: ' + err.message);
+        unloadScript(channel);
+    }
+}
+
+function unloadScript(channel) {
+    const context = contexts.get(channel);
+    if (!context || channel === 0) {
+        return;
+    }
+    context.closed = true;
+    for (const selector of Object.keys(context.handlers)) {
+        context.handlers[selector] = [];
+    }
+    contexts.delete(channel);
+    symbolTables.delete(channel);
+    if (currentContext === context) {
+        currentContext = rootContext;
+    }
+}
+
+// Pooled processes boot without a script and wait for a LOAD message
+const pooled = process.env.PD_NODE_POOL === '1';
+const userScript = process.argv[2];
+if (userScript) {
+    loadScript(userScript);
+} else if (pooled) {
+    // Pd went away before handing us a script
+    process.stdin.on('end', () => {
+        if (!scriptLoaded) {
+            process.exit(0);
+        }
+    });
 } else {
-    global.__pd_internal__.error('No script specified');
+    rootContext.error('No script specified');
+    flushOutput();
     process.exit(1);
 }
@@ -9,6 +9,11 @@
  */
 export type MessageHandler = (inlet: number, ...args: any[]) => void;
 
+/**
+ * Signal block callback of a [node~]
+ */
+export type DspCallback = (inputs: Float32Array[], outputs: Float32Array[]) => void;
+
 /**
  * Pure Data API interface
  */
@@ -38,6 +43,21 @@ export interface PD {
      */
     readonly args: any[];
     
+    /**
+     * Pd logical time (ms) of the last message received ([node --time])
+     */
+    readonly time: number;
+    
+    /**
+     * Sample rate of a [node~] (0 before DSP starts)
+     */
+    readonly sampleRate: number;
+    
+    /**
+     * Samples per signal block of a [node~] (0 before DSP starts)
+     */
+    readonly blockSize: number;
+    
     /**
      * API version
      */
@@ -54,9 +74,22 @@ export interface PD {
      * pd.outlet(0, 42);          // Send float
      * pd.outlet(0, 'hello');     // Send symbol
      * pd.outlet(0, [1, 2, 3]);   // Send list
+     * pd.outlet(0, spectrum);    // Send list from a Float32Array
      */
     outlet(outlet: number, ...values: any[]): void;
     
+    /**
+     * Send data to an outlet at a Pd logical time
+     * 
+     * @param time - Pd logical time in ms (see time); past times send now
+     * @param outlet - Outlet index (0-based)
+     * @param values - Values to send, as for outlet()
+     * 
+     * @example
+     * pd.outletAt(pd.time + 250, 0, 'note', 60);
+     */
+    outletAt(time: number, outlet: number, ...values: any[]): void;
+    
     /**
      * Print message to PD console
      * 
@@ -99,6 +132,41 @@ export interface PD {
      */
     on(message: string, callback: MessageHandler): void;
     
+    /**
+     * Process the signal blocks of a [node~]
+     * 
+     * @param callback - Gets one Float32Array per signal inlet and outlet
+     *                   (outputs start zeroed); null stops processing
+     * 
+     * @example
+     * pd.dsp((inputs, outputs) => {
+     *     outputs[0].set(inputs[0]);
+     * });
+     */
+    dsp(callback: DspCallback | null): void;
+    
+    /**
+     * A Pd array shared with [share name( on the object (Bun only)
+     * 
+     * @param name - Array name
+     * @returns Mirror of the array in shared memory, or undefined
+     * 
+     * @example
+     * pd.on('array', (name: string, data: Float32Array) => {
+     *     data.reverse();
+     *     pd.commit(name);
+     * });
+     */
+    array(name: string): Float32Array | undefined;
+    
+    /**
+     * Copy a shared array's mirror back into the Pd array
+     * (the object then sends [written name( from its right outlet)
+     * 
+     * @param name - Array name
+     */
+    commit(name: string): void;
+    
     /**
      * Remove message handler
      * 
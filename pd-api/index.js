@@ -25,6 +25,25 @@ const _internal = global.__pd_internal__ || {
     jsarguments: []
 };
 
+// Selector and arguments for the values given to pd.outlet()
+function outletMessage(values) {
+    if (values.length === 0) {
+        // Bang
+        return ['bang'];
+    }
+    if (values.length === 1) {
+        const value = values[0];
+        if (typeof value === 'number') {
+            return ['float', value];
+        } else if (typeof value === 'string') {
+            return ['symbol', value];
+        }
+        return ['anything', value];
+    }
+    // List
+    return ['list', ...values];
+}
+
 /**
  * Main pd-api object
  */
@@ -52,6 +71,25 @@ const pd = {
         return _internal.jsarguments || [];
     },
     
+    /**
+     * Pd logical time (ms) of the last message received, when the object
+     * was created with --time; 0 otherwise
+     */
+    get time() {
+        return _internal.time || 0;
+    },
+    
+    /**
+     * Sample rate and block size of a [node~] (0 before DSP starts)
+     */
+    get sampleRate() {
+        return _internal.sampleRate || 0;
+    },
+    
+    get blockSize() {
+        return _internal.blockSize || 0;
+    },
+    
     /**
      * Output to outlets
      * 
@@ -63,23 +101,36 @@ const pd = {
      * pd.outlet(0, 42);          // Send float
      * pd.outlet(0, 'hello');     // Send symbol
      * pd.outlet(0, [1, 2, 3]);   // Send list
+     * pd.outlet(0, spectrum);    // Send list from a Float32Array
      */
     outlet(outlet, ...values) {
-        if (values.length === 0) {
-            // Bang
-            _internal.outlet(outlet, 'bang');
-        } else if (values.length === 1) {
-            const value = values[0];
-            if (typeof value === 'number') {
-                _internal.outlet(outlet, 'float', value);
-            } else if (typeof value === 'string') {
-                _internal.outlet(outlet, 'symbol', value);
-            } else {
-                _internal.outlet(outlet, 'anything', value);
-            }
+        _internal.outlet(outlet, ...outletMessage(values));
+    },
+    
+    /**
+     * Output at a given Pd logical time
+     * 
+     * The message is held in Pd and sent exactly at `time` (ms, as in
+     * pd.time), independent of when the script gets to run. A time that
+     * has already passed sends it right away.
+     * 
+     * @param {number} time - Pd logical time in ms
+     * @param {number} outlet - Outlet index (0-based)
+     * @param {...any} values - Values to send, as for pd.outlet()
+     * 
+     * @example
+     * // [node --time seq.js]: a note every 125 ms, scheduled ahead
+     * pd.on('bang', () => {
+     *     for (let i = 0; i < 8; i++) {
+     *         pd.outletAt(pd.time + i * 125, 0, 60 + i);
+     *     }
+     * });
+     */
+    outletAt(time, outlet, ...values) {
+        if (_internal.outletAt) {
+            _internal.outletAt(time, outlet, ...outletMessage(values));
         } else {
-            // List
-            _internal.outlet(outlet, 'list', ...values);
+            _internal.outlet(outlet, ...outletMessage(values));
         }
     },
     
@@ -144,6 +195,67 @@ const pd = {
         }
     },
     
+    /**
+     * Process the signal blocks of a [node~]
+     * 
+     * The callback gets one Float32Array per signal inlet and outlet, each
+     * pd.blockSize samples long. Outputs start zeroed; whatever is written
+     * is played one block later (or --delay blocks). The arrays are reused,
+     * so copy anything that must outlive the call.
+     * 
+     * @param {Function|null} callback - (inputs, outputs) => void; null stops
+     * 
+     * @example
+     * pd.dsp((inputs, outputs) => {
+     *     const [input] = inputs;
+     *     const [output] = outputs;
+     *     for (let i = 0; i < input.length; i++) {
+     *         output[i] = input[i] * 0.5;
+     *     }
+     * });
+     */
+    dsp(callback) {
+        if (callback !== null && typeof callback !== 'function') {
+            throw new TypeError('Callback must be a function or null');
+        }
+        if (_internal.setDsp) {
+            _internal.setDsp(callback);
+        }
+    },
+    
+    /**
+     * A Pd array shared with [share name( on the object, or undefined
+     * 
+     * The Float32Array is a mirror of the array in shared memory (Bun only):
+     * reading it copies nothing. Pd refreshes it on every [share name(, and
+     * 'array' handlers run each time. Changes reach Pd on pd.commit(name).
+     * 
+     * @param {string} name - Array name
+     * @returns {Float32Array|undefined}
+     * 
+     * @example
+     * pd.on('array', (name, data) => {
+     *     const peak = data.reduce((max, v) => Math.max(max, Math.abs(v)), 0);
+     *     pd.outlet(0, peak);
+     * });
+     */
+    array(name) {
+        return _internal.array ? _internal.array(name) : undefined;
+    },
+    
+    /**
+     * Copy a shared array's mirror back into the Pd array
+     * 
+     * The object then sends [written name( from its right outlet.
+     * 
+     * @param {string} name - Array name
+     */
+    commit(name) {
+        if (_internal.commit) {
+            _internal.commit(name);
+        }
+    },
+    
     /**
      * Remove message handler
      * 